@@ -1,269 +1,1621 @@
+#define _GNU_SOURCE
+
 #include "board.h"
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <errno.h>
-#include <string.h>
-#include <semaphore.h>
-#include <pthread.h>
-#include <sys/shm.h>
-#include <sys/ipc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/shm.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if __APPLE__
+    #include <limits.h>
+#else
+    #include <linux/limits.h>
+#endif
+
+#include "communicator.h"
+#include "scheduler.h"
+#include "random.h"
+#include "renderer.h"
+#include "telemetry.h"
+#include "types.h"
+#include "player.h"
+
+/**
+ * Generates an unique key used to allocate a shared memory segment.
+ *
+ * @param id An integer number representing the segment ID.
+ *
+ * @return The generated unique key.
+ *
+ * @private
+ */
+key_t generate_shm_key(int id){
+    char current_path[PATH_MAX];
+    key_t shm_key;
+
+    /* Get the application path. */
+    getcwd(current_path, sizeof(current_path));
+    /* Generates the segment key. */
+    shm_key = ftok(current_path, id);
+    return shm_key;
+}
+
+/**
+ * Allocates a shared memory segment according to a given size.
+ *
+ * @param size An integer number representing the segment size in bytes.
+ * @param id An integer number used as a namespace to separate different memory segments having the same key.
+ *
+ * @return An integer number representing the shared memory segment ID.
+ *
+ * @private
+ */
+int generate_shared_memory_segment(size_t size, int id){
+    key_t shm_key;
+    int shm_id;
+
+    /* Generate an unique shared memory segment key. */
+    shm_key = generate_shm_key(id);
+    /* Allocate the shared memory segment. */
+    shm_id = shmget(shm_key, size, IPC_CREAT | 0660);
+    if ( shm_id < 0 ){
+        printf("Cannot allocate the memory segment, aborting.\n");
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    return shm_id;
+}
+
+/**
+ * Attaches a System V shared memory segment to current process memory.
+ *
+ * @param shm_id An integer number representing the shared memory segment ID.
+ *
+ * @return A pointer to the segment that has been attached.
+ *
+ * @private
+ */
+void* attach_shared_memory_segment(int shm_id){
+    void* shm_ptr;
+
+    shm_ptr = shmat(shm_id, NULL, 0);
+    if ( shm_ptr == (void*)-1 ){
+        printf("Cannot attach the shared memory segment, aborting.\n");
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(2);
+    }
+    return shm_ptr;
+}
+
+/**
+ * Creates an anonymous shared memory file: no name is left in the file system, so it vanishes along with the last process using it.
+ *
+ * @param huge_pages The pages the file should be backed by (HUGE_PAGES_NONE, HUGE_PAGES_ADVISE or HUGE_PAGES_RESERVED).
+ *
+ * @return The descriptor of the file or -1 if it cannot be created.
+ *
+ * @private
+ */
+int open_shared_memory_file(unsigned short huge_pages){
+#ifdef MFD_HUGETLB
+    return memfd_create("prochess-board", huge_pages == HUGE_PAGES_RESERVED ? MFD_HUGETLB : 0);
+#else
+    char name[64];
+    int fd;
+
+    if ( huge_pages == HUGE_PAGES_RESERVED ){
+        /* Only a memfd can be backed by reserved huge pages. */
+        return -1;
+    }
+    /* The name only has to be unique until it is unlinked right after creation. */
+    sprintf(name, "/prochess-%d", (int)getpid());
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if ( fd != -1 ){
+        shm_unlink(name);
+    }
+    return fd;
+#endif
+}
+
+/**
+ * Maps an anonymous shared memory file of the given size in current process memory, processes forked afterwards inherit the mapping.
+ *
+ * @param size An integer number representing the segment size in bytes, it must be a multiple of HUGE_PAGE_SIZE when huge pages are requested.
+ * @param huge_pages The pages the segment should be backed by (HUGE_PAGES_NONE, HUGE_PAGES_ADVISE or HUGE_PAGES_RESERVED).
+ * @param segment_fd The reference to the variable where the descriptor of the file will be stored at.
+ *
+ * @return A pointer to the segment that has been mapped.
+ *
+ * @private
+ */
+void* map_shared_memory_file(size_t size, unsigned short huge_pages, int* segment_fd){
+    void* segment;
+    int fd;
+
+    fd = open_shared_memory_file(huge_pages);
+    if ( fd != -1 && ftruncate(fd, (off_t)size) == 0 ){
+        segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if ( segment != MAP_FAILED ){
+#ifdef MADV_HUGEPAGE
+            if ( huge_pages == HUGE_PAGES_ADVISE ){
+                /* Only a hint, shared memory gets transparent huge pages if "shmem_enabled" allows it. */
+                madvise(segment, size, MADV_HUGEPAGE);
+            }
+#endif
+            *segment_fd = fd;
+            return segment;
+        }
+    }
+    if ( fd != -1 ){
+        close(fd);
+    }
+    if ( huge_pages == HUGE_PAGES_RESERVED ){
+        /* Mapping fails when not enough huge pages have been reserved. */
+        printf("Cannot reserve huge pages for the memory segment, using regular pages.\n");
+        return map_shared_memory_file(size, HUGE_PAGES_ADVISE, segment_fd);
+    }
+    printf("Cannot allocate the memory segment, aborting.\n");
+    printf("Reported error: %s.\n", strerror(errno));
+    exit(1);
+}
+
+/**
+ * Returns the amount of words each bitboard needs to cover the whole game board.
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return An integer number representing the amount of words.
+ *
+ * @private
+ */
+unsigned int compute_bitboard_words(unsigned int cell_count){
+    return ( cell_count + BITBOARD_WORD_BITS - 1 ) / BITBOARD_WORD_BITS;
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where bitboards are stored at (right after the cells).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes, aligned to the size of a bitboard word.
+ *
+ * @private
+ */
+size_t compute_bitboard_offset(unsigned int cell_count){
+    size_t offset;
+
+    offset = sizeof(board_t) + ( sizeof(cell_t) * cell_count );
+    return ( offset + sizeof(bitboard_word_t) - 1 ) / sizeof(bitboard_word_t) * sizeof(bitboard_word_t);
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where the free cell set is stored at (right after the bitboards).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes.
+ *
+ * @private
+ */
+size_t compute_free_cells_offset(unsigned int cell_count){
+    return compute_bitboard_offset(cell_count) + ( sizeof(bitboard_word_t) * compute_bitboard_words(cell_count) * BITBOARD_COUNT );
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where the distance maps are stored at (right after the free cell set).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes.
+ *
+ * @private
+ */
+size_t compute_distance_maps_offset(unsigned int cell_count){
+    return compute_free_cells_offset(cell_count) + ( sizeof(unsigned int) * cell_count );
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where the pawn slots are stored at (right after the distance maps).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes.
+ *
+ * @private
+ */
+size_t compute_pawn_slots_offset(unsigned int cell_count){
+    /* Two distance maps, the one pawns read and the one being built, plus the queue used to build them. */
+    return compute_distance_maps_offset(cell_count) + ( sizeof(unsigned int) * cell_count * 3 );
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where the neighbour table is stored at (right after the pawn slots).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes, aligned to the size of an entry of the table.
+ *
+ * @private
+ */
+size_t compute_neighbours_offset(unsigned int cell_count){
+    size_t offset;
+
+    /* There cannot be more pawns than cells. */
+    offset = compute_pawn_slots_offset(cell_count) + ( sizeof(pawn_slot_t) * cell_count );
+    return ( offset + sizeof(neighbours_t) - 1 ) / sizeof(neighbours_t) * sizeof(neighbours_t);
+}
+
+/**
+ * Returns the offset, from the beginning of the game board, where the neighbour counts are stored at (right after the neighbour table).
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ *
+ * @return The offset in bytes.
+ *
+ * @private
+ */
+size_t compute_neighbour_counts_offset(unsigned int cell_count){
+    return compute_neighbours_offset(cell_count) + ( sizeof(neighbours_t) * cell_count );
+}
+
+/**
+ * Returns the amount of pawn slots of a game board: there cannot be more pawns than cells, sparse boards have a fixed amount.
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ *
+ * @return The amount of pawn slots.
+ *
+ * @private
+ */
+unsigned int compute_pawn_slot_count(unsigned int cell_count, unsigned short layout){
+    if ( layout == BOARD_LAYOUT_SPARSE && cell_count > BOARD_SPARSE_PAWN_SLOTS ){
+        return BOARD_SPARSE_PAWN_SLOTS;
+    }
+    return cell_count;
+}
+
+/**
+ * Returns the offset, from the beginning of a sparse game board, where the pawn slots are stored at (right after the chunk directory).
+ *
+ * @param cell_count The amount of cells the board can store, padding included.
+ *
+ * @return The offset in bytes.
+ *
+ * @private
+ */
+size_t compute_sparse_pawn_slots_offset(unsigned int cell_count){
+    /* The chunk directory comes right after the board attributes, one entry per tile. */
+    return sizeof(board_t) + ( sizeof(unsigned int) * ( cell_count / BOARD_CHUNK_CELLS ) );
+}
+
+/**
+ * Returns the offset, from the beginning of a sparse game board, where the chunk pool is stored at (right after the pawn slots).
+ *
+ * @param cell_count The amount of cells the board can store, padding included.
+ *
+ * @return The offset in bytes, aligned to a cache line.
+ *
+ * @private
+ */
+size_t compute_chunk_pool_offset(unsigned int cell_count){
+    size_t offset;
+
+    offset = compute_sparse_pawn_slots_offset(cell_count) + ( sizeof(pawn_slot_t) * compute_pawn_slot_count(cell_count, BOARD_LAYOUT_SPARSE) );
+    return ( offset + 63 ) / 64 * 64;
+}
+
+/**
+ * Returns the size in bytes of the game board according to its dimensions.
+ * The pool of a sparse board can hold every tile but its pages are only touched once chunks are taken from it.
+ *
+ * @param cell_count The amount of cells stored, padding included.
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ *
+ * @return The size of the game board in bytes.
+ *
+ * @private
+ */
+size_t compute_board_size(unsigned int cell_count, unsigned short layout){
+    if ( layout == BOARD_LAYOUT_SPARSE ){
+        return compute_chunk_pool_offset(cell_count) + ( sizeof(board_chunk_t) * ( cell_count / BOARD_CHUNK_CELLS ) );
+    }
+    return compute_neighbour_counts_offset(cell_count) + ( sizeof(unsigned char) * cell_count );
+}
+
+/**
+ * Returns the amount of tiles in a row of tiles.
+ *
+ * @param width An integer number representing the chess board width.
+ *
+ * @return The amount of tiles.
+ *
+ * @private
+ */
+unsigned int compute_tile_columns(int width){
+    return ( width + ( 1 << BOARD_TILE_BITS ) - 1 ) >> BOARD_TILE_BITS;
+}
+
+/**
+ * Returns the amount of cells stored for a board, padding included.
+ *
+ * @param width An integer number representing the chess board width.
+ * @param height An integer number representing the chess board height.
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ *
+ * @return The amount of cells.
+ *
+ * @private
+ */
+unsigned int compute_cell_count(int width, int height, unsigned short layout){
+    if ( layout != BOARD_LAYOUT_COLUMNS ){
+        return compute_tile_columns(width) * compute_tile_columns(height) << ( BOARD_TILE_BITS * 2 );
+    }
+    return width * height;
+}
+
+/**
+ * Allocates the whole game board as a shared memory segment.
+ *
+ * @param width An integer number representing the chess board width.
+ * @param height An integer number representing the chess board height.
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ * @param allocator The way the segment is allocated (BOARD_ALLOCATOR_SYSV or BOARD_ALLOCATOR_MMAP).
+ * @param huge_pages The pages the segment should be backed by when allocated with mmap (HUGE_PAGES_NONE, HUGE_PAGES_ADVISE or HUGE_PAGES_RESERVED).
+ * @param segment_id The reference to the variable where the shared memory segment ID, or the descriptor of the mapped file, will be stored at.
+ * @param segment_size The reference to the variable where the size of the segment will be stored at.
+ *
+ * @return A pointer to the segment that has been allocated.
+ *
+ * @private
+ */
+void* allocate_board(int width, int height, unsigned short layout, unsigned short allocator, unsigned short huge_pages, int* segment_id, size_t* segment_size){
+    size_t size;
+
+    /* Calculate the size of the memory segment to allocate. */
+    size = compute_board_size(compute_cell_count(width, height, layout), layout);
+    if ( allocator == BOARD_ALLOCATOR_SYSV ){
+        *segment_size = size;
+        *segment_id = generate_shared_memory_segment(size, 1);
+        return attach_shared_memory_segment(*segment_id);
+    }
+    if ( layout == BOARD_LAYOUT_SPARSE ){
+        /* The first write to a chunk would fault in a whole huge page, scattered chunks would take far more memory than they need. */
+        huge_pages = HUGE_PAGES_NONE;
+    }
+    if ( huge_pages != HUGE_PAGES_NONE ){
+        size = ( size + HUGE_PAGE_SIZE - 1 ) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+    *segment_size = size;
+    return map_shared_memory_file(size, huge_pages, segment_id);
+}
+
+/**
+ * Returns the uni-dimensional array index based on given bi-dimensional coordinates.
+ *
+ * @param game_board The reference to the game board.
+ * @param coords The coordinates to convert.
+ *
+ * @return An integer number representing the equivalent array index.
+ */
+unsigned int compute_index(board_t* game_board, coords_t* coords){
+    return compute_index_from_params(game_board, coords->x, coords->y);
+}
+
+/**
+ * Returns the uni-dimensional array index based on given coordinates a integer numbers.
+ *
+ * @param game_board The reference to the game board.
+ * @param x The coordinate value on the x axis.
+ * @param y The coordinate value on the y axis.
+ *
+ * @return An integer number representing the equivalent array index.
+ */
+unsigned int compute_index_from_params(board_t* game_board, unsigned int x, unsigned int y){
+    unsigned int mask;
+
+    if ( game_board->layout != BOARD_LAYOUT_COLUMNS ){
+        /* The index of the tile followed by the position within the tile, both row by row. */
+        mask = ( 1 << BOARD_TILE_BITS ) - 1;
+        return ( ( ( y >> BOARD_TILE_BITS ) * game_board->tile_columns + ( x >> BOARD_TILE_BITS ) ) << ( BOARD_TILE_BITS * 2 ) ) | ( ( y & mask ) << BOARD_TILE_BITS ) | ( x & mask );
+    }
+    return x * game_board->height + y;
+}
+
+/**
+ * Returns the bi-dimensional coordinates of a cell based on its uni-dimensional array index, it is the inverse of "compute_index".
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ * @param coords The reference to the coordinates where the result will be stored at, the index included.
+ */
+void compute_coords(board_t* game_board, unsigned int index, coords_t* coords){
+    unsigned int mask, tile;
+
+    coords->index = index;
+    if ( game_board->layout != BOARD_LAYOUT_COLUMNS ){
+        mask = ( 1 << BOARD_TILE_BITS ) - 1;
+        tile = index >> ( BOARD_TILE_BITS * 2 );
+        coords->x = ( ( tile % game_board->tile_columns ) << BOARD_TILE_BITS ) | ( index & mask );
+        coords->y = ( ( tile / game_board->tile_columns ) << BOARD_TILE_BITS ) | ( ( index >> BOARD_TILE_BITS ) & mask );
+        return;
+    }
+    coords->x = index / game_board->height;
+    coords->y = index % game_board->height;
+}
+
+/**
+ * Returns the amount of moves a pawn needs to go from a cell to another one, pawns move along the axes one cell at a time.
+ *
+ * @param game_board The reference to the game board.
+ * @param from The index of the cell to start from.
+ * @param to The index of the cell to reach.
+ *
+ * @return The manhattan distance between the two cells.
+ */
+unsigned int compute_distance(board_t* game_board, unsigned int from, unsigned int to){
+    coords_t from_coords, to_coords;
+
+    compute_coords(game_board, from, &from_coords);
+    compute_coords(game_board, to, &to_coords);
+    return ( from_coords.x > to_coords.x ? from_coords.x - to_coords.x : to_coords.x - from_coords.x ) + ( from_coords.y > to_coords.y ? from_coords.y - to_coords.y : to_coords.y - from_coords.y );
+}
+
+/**
+ * Returns the chunk directory of a sparse game board, it holds an entry for each tile: zero if the tile has no chunk yet, BOARD_CHUNK_PENDING
+ * or BOARD_CHUNK_CONTENDED while a chunk is being taken for it, otherwise the position of its chunk in the pool plus one.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The reference to the entry of the first tile.
+ *
+ * @private
+ */
+unsigned int* get_chunk_directory(board_t* game_board){
+    return (unsigned int*)( (char*)game_board + game_board->chunk_directory_offset );
+}
+
+/**
+ * Returns the pool chunks of a sparse game board are taken from, in the order they have been taken.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The reference to the first chunk.
+ *
+ * @private
+ */
+board_chunk_t* get_chunk_pool(board_t* game_board){
+    return (board_chunk_t*)( (char*)game_board + game_board->chunk_pool_offset );
+}
+
+/**
+ * Returns the chunk holding a given cell of a sparse game board.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ *
+ * @return The reference to the chunk or NULL if no cell of its tile has ever been written.
+ *
+ * @private
+ */
+board_chunk_t* find_chunk(board_t* game_board, unsigned int index){
+    unsigned int entry;
+
+    entry = __atomic_load_n(&get_chunk_directory(game_board)[index / BOARD_CHUNK_CELLS], __ATOMIC_ACQUIRE);
+    if ( entry == 0 || entry == BOARD_CHUNK_PENDING || entry == BOARD_CHUNK_CONTENDED ){
+        /* A chunk still pending has not been written yet. */
+        return NULL;
+    }
+    return &get_chunk_pool(game_board)[entry - 1];
+}
+
+/**
+ * Returns the chunk holding a given cell of a sparse game board, taking a new one from the pool if its tile has none yet.
+ * The first process marks the tile as pending, clears the chunk and then publishes it, the others spin for a while and then
+ * sleep until it is published.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ *
+ * @return The reference to the chunk.
+ *
+ * @private
+ */
+board_chunk_t* materialize_chunk(board_t* game_board, unsigned int index){
+    unsigned int number, entry, attempts, *directory;
+    board_chunk_t* chunk;
+
+    directory = get_chunk_directory(game_board);
+    number = index / BOARD_CHUNK_CELLS;
+    entry = __atomic_load_n(&directory[number], __ATOMIC_ACQUIRE);
+    attempts = 0;
+    while ( entry == 0 || entry == BOARD_CHUNK_PENDING || entry == BOARD_CHUNK_CONTENDED ){
+        if ( entry == 0 ){
+            if ( __atomic_compare_exchange_n(&directory[number], &entry, BOARD_CHUNK_PENDING, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) ){
+                /* Each tile gets a chunk at most once, so the pool can never run out. */
+                entry = __atomic_fetch_add(&game_board->materialized_chunks, 1, __ATOMIC_RELAXED) + 1;
+                chunk = &get_chunk_pool(game_board)[entry - 1];
+                memset(chunk, 0, sizeof(board_chunk_t));
+                chunk->number = number;
+                if ( __atomic_exchange_n(&directory[number], entry, __ATOMIC_RELEASE) == BOARD_CHUNK_CONTENDED ){
+                    wake_on_word(&directory[number], 0x7fffffff);
+                }
+                return chunk;
+            }
+            /* Another process got there first, the entry now holds what it has written. */
+            continue;
+        }
+        if ( attempts < LOCK_SPIN_ATTEMPTS ){
+            attempts++;
+        }else if ( entry == BOARD_CHUNK_CONTENDED || __atomic_compare_exchange_n(&directory[number], &entry, BOARD_CHUNK_CONTENDED, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) ){
+            /* The process taking the chunk may have been preempted, sleep until it publishes the chunk rather than spinning. */
+            wait_on_word(&directory[number], BOARD_CHUNK_CONTENDED, NULL);
+        }
+        entry = __atomic_load_n(&directory[number], __ATOMIC_ACQUIRE);
+    }
+    return &get_chunk_pool(game_board)[entry - 1];
+}
+
+/**
+ * Returns the content of a given cell, the cells of a sparse board that have never been written are empty.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ *
+ * @return The content of the cell.
+ */
+cell_t load_cell(board_t* game_board, unsigned int index){
+    board_chunk_t* chunk;
+
+    if ( game_board->layout != BOARD_LAYOUT_SPARSE ){
+        return __atomic_load_n(&game_board->cells[index], __ATOMIC_RELAXED);
+    }
+    chunk = find_chunk(game_board, index);
+    return chunk == NULL ? 0 : __atomic_load_n(&chunk->cells[index % BOARD_CHUNK_CELLS], __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the reference to a given cell so that it can be written, on a sparse board the chunk holding the cell is taken from the pool if needed.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ *
+ * @return The reference to the cell.
+ */
+cell_t* get_cell(board_t* game_board, unsigned int index){
+    if ( game_board->layout != BOARD_LAYOUT_SPARSE ){
+        return &game_board->cells[index];
+    }
+    return &materialize_chunk(game_board, index)->cells[index % BOARD_CHUNK_CELLS];
+}
+
+/**
+ * Marks the beginning of a change to the cells of the game board, snapshots being taken meanwhile will be taken again.
+ * Each sequence has a single writer, so it is bumped with plain stores.
+ *
+ * @param sequence The reference to the sequence of the writer: the one in the slot of the pawn or the one of the master process.
+ *
+ * @private
+ */
+void begin_board_write(unsigned int* sequence){
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    /* The sequence must be visible before any of the cells written afterwards. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Marks the end of a change to the cells of the game board.
+ *
+ * @param sequence The reference to the sequence of the writer.
+ *
+ * @private
+ */
+void end_board_write(unsigned int* sequence){
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the reference to a given bitboard, sparse boards have no whole bitboard as each chunk holds its own words.
+ *
+ * @param game_board The reference to the game board.
+ * @param bitboard The bitboard to return (BITBOARD_OCCUPIED).
+ *
+ * @return A pointer to the first word of the bitboard.
+ */
+bitboard_word_t* get_bitboard(board_t* game_board, unsigned int bitboard){
+    return (bitboard_word_t*)( (char*)game_board + game_board->bitboard_offset ) + ( bitboard * game_board->bitboard_words );
+}
+
+/**
+ * Returns the reference to the bitboard word holding the bit of a given cell.
+ *
+ * @param game_board The reference to the game board.
+ * @param bitboard The bitboard to look up.
+ * @param index The index of the cell.
+ * @param materialize If "1" the chunk holding the cell of a sparse board is taken from the pool if needed.
+ *
+ * @return The reference to the word or NULL if the cell belongs to a chunk of a sparse board that has not been taken.
+ *
+ * @private
+ */
+bitboard_word_t* get_bitboard_word(board_t* game_board, unsigned int bitboard, unsigned int index, boolean materialize){
+    board_chunk_t* chunk;
+
+    if ( game_board->layout != BOARD_LAYOUT_SPARSE ){
+        return &get_bitboard(game_board, bitboard)[index / BITBOARD_WORD_BITS];
+    }
+    chunk = materialize == 1 ? materialize_chunk(game_board, index) : find_chunk(game_board, index);
+    return chunk == NULL ? NULL : &chunk->bitboards[bitboard][( index % BOARD_CHUNK_CELLS ) / BITBOARD_WORD_BITS];
+}
+
+/**
+ * Marks a cell in a given bitboard, the word is updated atomically as it is shared with the neighbouring cells.
+ *
+ * @param game_board The reference to the game board.
+ * @param bitboard The bitboard to update.
+ * @param index The index of the cell to mark.
+ */
+void set_bitboard_cell(board_t* game_board, unsigned int bitboard, unsigned int index){
+    __atomic_fetch_or(get_bitboard_word(game_board, bitboard, index, 1), (bitboard_word_t)1 << ( index % BITBOARD_WORD_BITS ), __ATOMIC_RELAXED);
+}
+
+/**
+ * Unmarks a cell in a given bitboard, the word is updated atomically as it is shared with the neighbouring cells.
+ *
+ * @param game_board The reference to the game board.
+ * @param bitboard The bitboard to update.
+ * @param index The index of the cell to unmark.
+ */
+void clear_bitboard_cell(board_t* game_board, unsigned int bitboard, unsigned int index){
+    __atomic_fetch_and(get_bitboard_word(game_board, bitboard, index, 1), ~( (bitboard_word_t)1 << ( index % BITBOARD_WORD_BITS ) ), __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the neighbour table, it holds an entry for each cell, indexed like the cells; sparse boards have none.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The reference to the entry of the first cell.
+ */
+neighbours_t* get_neighbours(board_t* game_board){
+    return (neighbours_t*)( (char*)game_board + game_board->neighbours_offset );
+}
+
+/**
+ * Returns the amount of neighbours each cell has, indexed like the cells: 2 for the corners, 3 for the edges and 4 otherwise.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The reference to the count of the first cell.
+ */
+unsigned char* get_neighbour_counts(board_t* game_board){
+    return (unsigned char*)game_board + game_board->neighbour_counts_offset;
+}
+
+/**
+ * Lists the neighbours of a cell: top, right, bottom and left, skipping the ones out of the board.
+ *
+ * @param game_board The reference to the game board.
+ * @param x The coordinate value of the cell on the x axis.
+ * @param y The coordinate value of the cell on the y axis.
+ * @param neighbours The reference to the entry the indexes of the neighbours will be stored in.
+ *
+ * @return The amount of neighbours listed.
+ *
+ * @private
+ */
+unsigned int compute_neighbours(board_t* game_board, unsigned int x, unsigned int y, neighbours_t* neighbours){
+    unsigned int count;
+
+    count = 0;
+    if ( y > 0 ){
+        neighbours->cells[count++] = compute_index_from_params(game_board, x, y - 1);
+    }
+    if ( x < game_board->width - 1 ){
+        neighbours->cells[count++] = compute_index_from_params(game_board, x + 1, y);
+    }
+    if ( y < game_board->height - 1 ){
+        neighbours->cells[count++] = compute_index_from_params(game_board, x, y + 1);
+    }
+    if ( x > 0 ){
+        neighbours->cells[count++] = compute_index_from_params(game_board, x - 1, y);
+    }
+    return count;
+}
+
+/**
+ * Lists the neighbours of a given cell, they are read from the neighbour table or computed on sparse boards.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell.
+ * @param neighbours The reference to the entry the indexes of the neighbours will be stored in.
+ *
+ * @return The amount of neighbours listed.
+ */
+unsigned int get_cell_neighbours(board_t* game_board, unsigned int index, neighbours_t* neighbours){
+    coords_t coords;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        compute_coords(game_board, index, &coords);
+        return compute_neighbours(game_board, coords.x, coords.y, neighbours);
+    }
+    *neighbours = get_neighbours(game_board)[index];
+    return get_neighbour_counts(game_board)[index];
+}
+
+/**
+ * Fills the neighbour table in.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void build_neighbour_table(board_t* game_board){
+    unsigned int x, y, index;
+    neighbours_t* neighbours;
+    unsigned char* counts;
+
+    neighbours = get_neighbours(game_board);
+    counts = get_neighbour_counts(game_board);
+    /* Padding cells have no neighbour. */
+    memset(counts, 0, game_board->cell_count);
+    for ( x = 0 ; x < game_board->width ; x++ ){
+        for ( y = 0 ; y < game_board->height ; y++ ){
+            index = compute_index_from_params(game_board, x, y);
+            counts[index] = (unsigned char)compute_neighbours(game_board, x, y, &neighbours[index]);
+        }
+    }
+}
+
+/**
+ * Sets up the attributes and the cells of a freshly allocated game board.
+ *
+ * @param game_board The reference to the game board.
+ * @param width An integer number representing the chess board width.
+ * @param height An integer number representing the chess board height.
+ * @param execution_mode The way players and pawns are going to run (EXECUTION_MODE_PROCESS, EXECUTION_MODE_THREAD or EXECUTION_MODE_TASK).
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ *
+ * @private
+ */
+void initialize_board(board_t* game_board, int width, int height, unsigned short execution_mode, unsigned short layout){
+    unsigned int i, cell_count;
+
+    /* Set basic board attributes. */
+    game_board->width = width;
+    game_board->height = height;
+    game_board->layout = layout;
+    game_board->tile_columns = compute_tile_columns(width);
+    game_board->cell_count = cell_count = compute_cell_count(width, height, layout);
+    game_board->execution_mode = execution_mode;
+    game_board->coordinator_mq_id = open_message_queue(game_board);
+    game_board->transport = TRANSPORT_MESSAGE_QUEUE;
+    game_board->placement = PLACEMENT_TURNS;
+    init_message_ring(&game_board->coordinator_ring);
+    game_board->coordinator_pid = getpid();
+    game_board->scheduler = NULL;
+    game_board->waiting_time = 0;
+    game_board->active_distance_map = 0;
+    game_board->distance_map_sequences[0] = game_board->distance_map_sequences[1] = 0;
+    game_board->pawn_slot_count = compute_pawn_slot_count(cell_count, layout);
+    game_board->chunk_count = game_board->materialized_chunks = 0;
+    if ( layout == BOARD_LAYOUT_SPARSE ){
+        /* Only the chunk directory is touched, chunks are taken from the pool as cells are written. */
+        game_board->bitboard_words = 0;
+        game_board->chunk_count = cell_count / BOARD_CHUNK_CELLS;
+        game_board->chunk_directory_offset = sizeof(board_t);
+        game_board->pawn_slots_offset = compute_sparse_pawn_slots_offset(cell_count);
+        game_board->chunk_pool_offset = compute_chunk_pool_offset(cell_count);
+        memset(get_chunk_directory(game_board), 0, sizeof(unsigned int) * game_board->chunk_count);
+    }else{
+        /* Bitboards are addressed by offset so that they can be found in every process the segment is attached to. */
+        game_board->bitboard_words = compute_bitboard_words(cell_count);
+        game_board->bitboard_offset = compute_bitboard_offset(cell_count);
+        game_board->free_cells_offset = compute_free_cells_offset(cell_count);
+        game_board->distance_maps_offset = compute_distance_maps_offset(cell_count);
+        game_board->pawn_slots_offset = compute_pawn_slots_offset(cell_count);
+        game_board->neighbours_offset = compute_neighbours_offset(cell_count);
+        game_board->neighbour_counts_offset = compute_neighbour_counts_offset(cell_count);
+        /* The neighbours of a cell only depend on the dimensions of the board. */
+        build_neighbour_table(game_board);
+    }
+    game_board->free_cells_lock = 0;
+    /* Sequences are never reset afterwards, a snapshot may be taken while the board is cleared. */
+    game_board->sequence = 0;
+    for ( i = 0 ; i < game_board->pawn_slot_count ; i++ ){
+        get_pawn_slots(game_board)[i].sequence = 0;
+        get_pawn_slots(game_board)[i].mq_id = -1;
+        get_pawn_slots(game_board)[i].moves = get_pawn_slots(game_board)[i].blocked_moves = 0;
+    }
+    /* Telemetry covers the whole game, it is not reset when the board is cleared. */
+    memset(&game_board->telemetry, 0, sizeof(telemetry_t));
+#ifdef SO_TELEMETRY
+    game_board->telemetry.moves_measured = 1;
+#endif
+    seed_board(game_board, 0);
+    clear_board(game_board);
+}
+
+/**
+ * Sets the seed of the game: the master process draws from stream zero while each pawn draws from its own stream.
+ *
+ * @param game_board The reference to the game board.
+ * @param seed The seed of the game, the same seed gives the same flags and pawn positions.
+ */
+void seed_board(board_t* game_board, unsigned long seed){
+    game_board->random_seed = seed;
+    seed_random(&game_board->generator, seed, 0);
+}
+
+/**
+ * Marks the padding cells as occupied so that they never end up in the free cell set, only tiled boards have any.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void mark_padding_cells(board_t* game_board){
+    unsigned int x, y, width, height;
+
+    if ( game_board->layout != BOARD_LAYOUT_TILES ){
+        return;
+    }
+    width = game_board->tile_columns << BOARD_TILE_BITS;
+    height = game_board->cell_count / width;
+    for ( y = 0 ; y < height ; y++ ){
+        for ( x = 0 ; x < width ; x++ ){
+            if ( x >= (unsigned int)game_board->width || y >= (unsigned int)game_board->height ){
+                set_bitboard_cell(game_board, BITBOARD_OCCUPIED, compute_index_from_params(game_board, x, y));
+            }
+        }
+    }
+}
+
+/**
+ * Brings the game board back to its initial state: no pawn, no flag and all the counters set to zero.
+ * It must not be called while pawns are playing, the simulator uses it to reuse the same board for each game.
+ *
+ * @param game_board The reference to the game board.
+ */
+void clear_board(board_t* game_board){
+    unsigned int i, *directory;
+    board_chunk_t* chunk_pool;
+    pawn_slot_t* pawn_slots;
+
+    begin_board_write(&game_board->sequence);
+    game_board->round_in_progress = 0;
+    game_board->control_generation = game_board->round_started_pawns = 0;
+    game_board->round_release_time = game_board->round_start_latency_total = game_board->round_start_latency_max = 0;
+    memset(game_board->used_moves, 0, sizeof(game_board->used_moves));
+    game_board->flag_count = game_board->capture_generation = 0;
+    memset(game_board->captured_flags, 0, sizeof(game_board->captured_flags));
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        /* Give all the chunks back to the pool, they are cleared again when taken. */
+        directory = get_chunk_directory(game_board);
+        chunk_pool = get_chunk_pool(game_board);
+        for ( i = 0 ; i < game_board->materialized_chunks ; i++ ){
+            directory[chunk_pool[i].number] = 0;
+        }
+        game_board->materialized_chunks = 0;
+    }else{
+        /* A zeroed cell is an empty one. */
+        memset(game_board->cells, 0, sizeof(cell_t) * game_board->cell_count);
+        memset(get_bitboard(game_board, 0), 0, sizeof(bitboard_word_t) * game_board->bitboard_words * BITBOARD_COUNT);
+        mark_padding_cells(game_board);
+    }
+    end_board_write(&game_board->sequence);
+    /* Every cell is free on an empty board. */
+    game_board->planned_positions = game_board->placement_plan_end = 0;
+    rebuild_free_cells(game_board);
+    /* No flag, every cell is unreachable. */
+    update_distance_map(game_board);
+    pawn_slots = get_pawn_slots(game_board);
+    for ( i = 0 ; i < game_board->pawn_slot_count ; i++ ){
+        pawn_slots[i].position = PAWN_POSITION_UNKNOWN;
+        pawn_slots[i].target = PAWN_TARGET_NEAREST;
+    }
+}
+
+/**
+ * Generate the game board as a shared memory segment, players and pawns find it in their memory once they are forked.
+ *
+ * @param width An integer number representing the chess board width.
+ * @param height An integer number representing the chess board height.
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ * @param allocator The way the segment is allocated (BOARD_ALLOCATOR_SYSV or BOARD_ALLOCATOR_MMAP).
+ * @param huge_pages The pages the segment should be backed by when allocated with mmap (HUGE_PAGES_NONE, HUGE_PAGES_ADVISE or HUGE_PAGES_RESERVED).
+ *
+ * @return A pointer to the game board that has been allocated.
+ */
+board_t* generate_board(int width, int height, unsigned short layout, unsigned short allocator, unsigned short huge_pages){
+    board_t* game_board;
+    size_t segment_size;
+    int segment_id;
+
+    game_board = (board_t*)allocate_board(width, height, layout, allocator, huge_pages, &segment_id, &segment_size);
+    game_board->allocator = allocator;
+    game_board->segment_id = segment_id;
+    game_board->segment_size = segment_size;
+    initialize_board(game_board, width, height, EXECUTION_MODE_PROCESS, layout);
+    return game_board;
+}
+
+/**
+ * Generate the game board in the heap of current process, it can be used only when players and pawns run as threads.
+ *
+ * @param width An integer number representing the chess board width.
+ * @param height An integer number representing the chess board height.
+ * @param execution_mode The way players and pawns are going to run (EXECUTION_MODE_THREAD, EXECUTION_MODE_TASK or EXECUTION_MODE_SIMULATION).
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ *
+ * @return A pointer to the game board that has been allocated.
+ */
+board_t* generate_local_board(int width, int height, unsigned short execution_mode, unsigned short layout){
+    board_t* game_board;
+
+    game_board = (board_t*)malloc(compute_board_size(compute_cell_count(width, height, layout), layout));
+    if ( game_board == NULL ){
+        printf("Cannot allocate the game board, aborting.\n");
+        exit(1);
+    }
+    initialize_board(game_board, width, height, execution_mode, layout);
+    if ( execution_mode == EXECUTION_MODE_TASK ){
+        /* Pawns will run as tasks on one worker thread per core. */
+        game_board->scheduler = start_scheduler(0);
+    }
+    return game_board;
+}
+
+/**
+ * Attaches, read only, the game board a master process is playing on.
+ *
+ * @param segment The path of the file the board is mapped from, or the ID of the shared memory segment it lives in.
+ *
+ * @return A pointer to the game board.
+ */
+board_t* attach_board(const char* segment){
+    struct stat status;
+    void* address;
+    int fd;
+
+    if ( segment[0] == '/' ){
+        /* The file is unlinked, it can only be reached through the descriptor table of the master process. */
+        fd = open(segment, O_RDONLY);
+        address = MAP_FAILED;
+        if ( fd != -1 ){
+            if ( fstat(fd, &status) == 0 ){
+                address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+        }
+    }else{
+        address = shmat(atoi(segment), NULL, SHM_RDONLY);
+        address = address == (void*)-1 ? MAP_FAILED : address;
+    }
+    if ( address == MAP_FAILED ){
+        printf("Cannot attach the game board, aborting.\n");
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    return (board_t*)address;
+}
+
+/**
+ * Copies the cells and the flag index of a game board into a local one of the same size and layout.
+ *
+ * @param game_board The reference to the game board to copy.
+ * @param snapshot The reference to the board the copy is written to.
+ *
+ * @private
+ */
+void copy_board_content(board_t* game_board, board_t* snapshot){
+    unsigned int i, j, *directory;
+    board_chunk_t *source, *target;
 
-#if __APPLE__
-    #include <limits.h>
-#else
-    #include <linux/limits.h>
-#endif
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        /* Give back the chunks of the last copy, then copy the ones taken so far keeping their order. */
+        directory = get_chunk_directory(snapshot);
+        target = get_chunk_pool(snapshot);
+        for ( i = 0 ; i < snapshot->materialized_chunks ; i++ ){
+            directory[target[i].number] = 0;
+        }
+        source = get_chunk_pool(game_board);
+        snapshot->materialized_chunks = __atomic_load_n(&game_board->materialized_chunks, __ATOMIC_ACQUIRE);
+        for ( i = 0 ; i < snapshot->materialized_chunks ; i++ ){
+            /* A chunk being taken may not have its number yet, the copy is thrown away anyway in that case. */
+            target[i].number = source[i].number < snapshot->chunk_count ? source[i].number : 0;
+            for ( j = 0 ; j < BOARD_CHUNK_CELLS ; j++ ){
+                target[i].cells[j] = __atomic_load_n(&source[i].cells[j], __ATOMIC_RELAXED);
+            }
+            directory[target[i].number] = i + 1;
+        }
+    }else{
+        for ( i = 0 ; i < game_board->cell_count ; i++ ){
+            snapshot->cells[i] = __atomic_load_n(&game_board->cells[i], __ATOMIC_RELAXED);
+        }
+    }
+    snapshot->round_in_progress = __atomic_load_n(&game_board->round_in_progress, __ATOMIC_RELAXED);
+    snapshot->capture_generation = game_board->capture_generation;
+    snapshot->flag_count = game_board->flag_count < MAX_FLAGS ? game_board->flag_count : MAX_FLAGS;
+    memcpy(snapshot->flags, game_board->flags, sizeof(flag_t) * snapshot->flag_count);
+}
 
-#include "communicator.h"
-#include "types.h"
-#include "player.h"
+/**
+ * Takes a consistent copy of the cells and of the flag index of a game board pawns may be playing on, no pawn is ever slowed down:
+ * the copy is taken again whenever a pawn has changed the board meanwhile. Bitboards and everything else are not copied.
+ * The sequences of the pawns are kept in the pawn slots of the snapshot while copying, so nothing is allocated per copy.
+ *
+ * @param game_board The reference to the game board to copy.
+ * @param snapshot The reference to a local board of the same size and layout the copy is written to.
+ * @param max_attempts The amount of copies to take at most.
+ *
+ * @return The amount of copies taken or 0 if none of them was consistent, the content of the snapshot is undefined then.
+ */
+unsigned int take_board_snapshot(board_t* game_board, board_t* snapshot, unsigned int max_attempts){
+    pawn_slot_t *pawn_slots, *snapshot_slots;
+    unsigned int i, attempts, sequence;
+    boolean consistent;
+
+    pawn_slots = get_pawn_slots(game_board);
+    snapshot_slots = get_pawn_slots(snapshot);
+    for ( attempts = 1 ; attempts <= max_attempts ; attempts++ ){
+        /* An odd sequence means its writer is in the middle of a change. */
+        sequence = __atomic_load_n(&game_board->sequence, __ATOMIC_ACQUIRE);
+        consistent = ( sequence & 1 ) == 0;
+        for ( i = 0 ; i < game_board->pawn_slot_count && consistent == 1 ; i++ ){
+            snapshot_slots[i].sequence = __atomic_load_n(&pawn_slots[i].sequence, __ATOMIC_ACQUIRE);
+            consistent = ( snapshot_slots[i].sequence & 1 ) == 0;
+        }
+        if ( consistent == 0 ){
+            /* Let the writer finish. */
+            sched_yield();
+            continue;
+        }
+        copy_board_content(game_board, snapshot);
+        /* Cells must be read before the sequences are read again. */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        consistent = __atomic_load_n(&game_board->sequence, __ATOMIC_RELAXED) == sequence;
+        for ( i = 0 ; i < game_board->pawn_slot_count && consistent == 1 ; i++ ){
+            consistent = __atomic_load_n(&pawn_slots[i].sequence, __ATOMIC_RELAXED) == snapshot_slots[i].sequence;
+        }
+        if ( consistent == 1 ){
+            return attempts;
+        }
+    }
+    return 0;
+}
 
 /**
- * Generates an unique key used to allocate a shared memory segment.
+ * Returns the reference to the dense array holding the indexes of the free cells.
  *
- * @param id An integer number representing the segment ID.
+ * @param game_board The reference to the game board.
  *
- * @return The generated unique key.
+ * @return A pointer to the first element of the array.
  *
  * @private
  */
-key_t generate_shm_key(int id){
-    char current_path[PATH_MAX];
-    key_t shm_key;
+unsigned int* get_free_cells(board_t* game_board){
+    return (unsigned int*)( (char*)game_board + game_board->free_cells_offset );
+}
 
-    /* Get the application path. */
-    getcwd(current_path, sizeof(current_path));
-    /* Generates the segment key. */
-    shm_key = ftok(current_path, id);
-    return shm_key;
+/**
+ * Acquires the lock guarding the free cell set, it lives in the game board so it works across processes too.
+ * The lock word is 0 when free, 1 when taken and 2 when taken with processes sleeping on it: the lock is tried a few times,
+ * then contenders sleep until the holder lets it go rather than burning their time slice while it is preempted.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void lock_free_cells(board_t* game_board){
+    unsigned int attempts, expected;
+
+    for ( attempts = 0 ; attempts < LOCK_SPIN_ATTEMPTS ; attempts++ ){
+        expected = 0;
+        if ( __atomic_compare_exchange_n(&game_board->free_cells_lock, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ){
+            return;
+        }
+    }
+    /* Taken as contended, whoever gets it this way wakes up the next sleeper when releasing it. */
+    while ( __atomic_exchange_n(&game_board->free_cells_lock, 2, __ATOMIC_ACQUIRE) != 0 ){
+        wait_on_word(&game_board->free_cells_lock, 2, NULL);
+    }
 }
 
 /**
- * Allocates a shared memory segment according to a given size.
+ * Releases the lock guarding the free cell set, waking up one of the processes sleeping on it if any.
  *
- * @param size An integer number representing the segment size in bytes.
- * @param id An integer number used as a namespace to separate different memory segments having the same key.
+ * @param game_board The reference to the game board.
  *
- * @return An integer number representing the shared memory segment ID.
+ * @private
+ */
+void unlock_free_cells(board_t* game_board){
+    if ( __atomic_exchange_n(&game_board->free_cells_lock, 0, __ATOMIC_RELEASE) == 2 ){
+        wake_on_word(&game_board->free_cells_lock, 1);
+    }
+}
+
+/**
+ * Fills the free cell set with all the cells that are not marked in the occupancy bitboard.
+ *
+ * @param game_board The reference to the game board.
+ */
+void rebuild_free_cells(board_t* game_board){
+    unsigned int i, length, count, *free_cells;
+    bitboard_word_t *occupied, word;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        /* Free cells are drawn at random instead. */
+        game_board->free_cell_count = 0;
+        return;
+    }
+    length = game_board->cell_count;
+    occupied = get_bitboard(game_board, BITBOARD_OCCUPIED);
+    free_cells = get_free_cells(game_board);
+    count = 0;
+    lock_free_cells(game_board);
+    for ( i = 0 ; i < game_board->bitboard_words ; i++ ){
+        word = ~__atomic_load_n(&occupied[i], __ATOMIC_RELAXED);
+        while ( word != 0 ){
+            if ( i * BITBOARD_WORD_BITS + __builtin_ctzl(word) >= length ){
+                /* Bits past the last cell of the board. */
+                break;
+            }
+            free_cells[count++] = i * BITBOARD_WORD_BITS + __builtin_ctzl(word);
+            word &= word - 1;
+        }
+    }
+    game_board->free_cell_count = count;
+    unlock_free_cells(game_board);
+}
+
+/**
+ * Picks a free position of a sparse game board drawing cells at random until an empty one is found, such boards are mostly empty.
+ *
+ * @param game_board The reference to the game board.
+ * @param position The reference to the coordinates where the position found will be stored at.
+ * @param generator The reference to the random number generator of the caller.
+ *
+ * @return If a position has been found will be returned "1", if none has been found after BOARD_SPARSE_FREE_CELL_DRAWS draws "0".
  *
  * @private
  */
-int generate_shared_memory_segment(size_t size, int id){
-    key_t shm_key;
-    int shm_id;
+boolean draw_free_position(board_t* game_board, coords_t* position, random_t* generator){
+    unsigned int i, x, y, index;
 
-    /* Generate an unique shared memory segment key. */
-    shm_key = generate_shm_key(id);
-    /* Allocate the shared memory segment. */
-    shm_id = shmget(shm_key, size, IPC_CREAT | 0660);
-    if ( shm_id < 0 ){
-        printf("Cannot allocate the memory segment, aborting.\n");
-        printf("Reported error: %s.\n", strerror(errno));
-        exit(1);
+    for ( i = 0 ; i < BOARD_SPARSE_FREE_CELL_DRAWS ; i++ ){
+        x = random_below(generator, game_board->width);
+        y = random_below(generator, game_board->height);
+        index = compute_index_from_params(game_board, x, y);
+        if ( CELL_OCCUPANT_TYPE(load_cell(game_board, index)) == 0 ){
+            compute_coords(game_board, index, position);
+            return 1;
+        }
     }
-    return shm_id;
+    return 0;
 }
 
 /**
- * Allocates the whole game board as a shared memory segment.
+ * Picks a free position in the game board uniformly at random and removes it from the free cell set.
+ * The set is not updated by moves, so the cell must still be claimed with "place_pawn" or a compare-and-swap.
  *
- * @param width An integer number representing the chess board width.
- * @param height An integer number representing the chess board height.
+ * @param game_board The reference to the game board.
+ * @param position The reference to the coordinates where the position found will be stored at.
+ * @param generator The reference to the random number generator of the caller.
  *
- * @return An integer number representing the shared memory segment ID.
+ * @return If a position has been found will be returned "1", if the set is empty "0".
+ */
+boolean take_free_position(board_t* game_board, coords_t* position, random_t* generator){
+    unsigned int slot, *free_cells;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        return draw_free_position(game_board, position, generator);
+    }
+    free_cells = get_free_cells(game_board);
+    lock_free_cells(game_board);
+    if ( game_board->free_cell_count == 0 ){
+        unlock_free_cells(game_board);
+        return 0;
+    }
+    slot = random_below(generator, game_board->free_cell_count);
+    position->index = free_cells[slot];
+    /* Swap-remove: the last free cell takes the place of the one picked. */
+    game_board->free_cell_count--;
+    free_cells[slot] = free_cells[game_board->free_cell_count];
+    unlock_free_cells(game_board);
+    compute_coords(game_board, position->index, position);
+    return 1;
+}
+
+/**
+ * Records the given player as the owner of the flag placed on a given cell.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell the flag has been conquered at.
+ * @param player_pseudo_name The pseudo name associated to the player that has conquered the flag.
  *
  * @private
  */
-int allocate_board(int width, int height){
-    size_t size;
-    int shm_id;
+void capture_flag(board_t* game_board, unsigned int index, char player_pseudo_name){
+    unsigned int i;
 
-    /* Calculate the size of the memory segment to allocate. */
-    size = sizeof(board_t) + ( sizeof(cell_t) * height * width );
-    /* Allocate the memory segment. */
-    shm_id = generate_shared_memory_segment(size, 1);
-    return shm_id;
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        if ( game_board->flags[i].index == index ){
+            __atomic_store_n(&game_board->flags[i].owner, player_pseudo_name, __ATOMIC_RELEASE);
+            /* Publish the capture: pawns only need to load the generation to find out something has changed. */
+            __atomic_fetch_or(&game_board->captured_flags[i / BITBOARD_WORD_BITS], (bitboard_word_t)1 << ( i % BITBOARD_WORD_BITS ), __ATOMIC_RELAXED);
+            __atomic_add_fetch(&game_board->capture_generation, 1, __ATOMIC_RELEASE);
+            return;
+        }
+    }
 }
 
 /**
- * Returns the uni-dimensional array index based on given bi-dimensional coordinates.
+ * Returns the distance maps, the one pawns read and the one being built, followed by the queue used to build them.
  *
  * @param game_board The reference to the game board.
- * @param coords The coordinates to convert.
  *
- * @return An integer number representing the equivalent array index.
+ * @return The reference to the first distance map.
+ *
+ * @private
  */
-unsigned int compute_index(board_t* game_board, coords_t* coords){
-    return coords->x * game_board->height + coords->y;
+unsigned int* get_distance_maps(board_t* game_board){
+    return (unsigned int*)( (char*)game_board + game_board->distance_maps_offset );
 }
 
 /**
- * Returns the uni-dimensional array index based on given coordinates a integer numbers.
+ * Returns the distance map pawns should walk down on: each cell holds the amount of moves needed to reach the nearest uncaptured flag.
+ * Entries must be read with relaxed atomic loads and then checked with "is_distance_map_current", as two rebuilds in a row may
+ * rewrite the map while it is being read.
  *
  * @param game_board The reference to the game board.
- * @param x The coordinate value on the x axis.
- * @param y The coordinate value on the y axis.
+ * @param sequence The reference to the variable where the sequence of the map will be stored at.
  *
- * @return An integer number representing the equivalent array index.
+ * @return The reference to the distance map, it is indexed like the cells, or NULL on sparse boards as they have none.
  */
-unsigned int compute_index_from_params(board_t* game_board, unsigned int x, unsigned int y){
-    return x * game_board->height + y;
+unsigned int* get_distance_map(board_t* game_board, unsigned int* sequence){
+    unsigned int active;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        return NULL;
+    }
+    do {
+        /* An odd sequence means the map is being rebuilt, the active one has changed meanwhile. */
+        active = __atomic_load_n(&game_board->active_distance_map, __ATOMIC_ACQUIRE);
+        *sequence = __atomic_load_n(&game_board->distance_map_sequences[active], __ATOMIC_ACQUIRE);
+    } while ( *sequence % 2 != 0 );
+    return get_distance_maps(game_board) + ( active * game_board->cell_count );
 }
 
 /**
- * Generate the game board as a shared memory segment.
+ * Checks that a distance map has not been rebuilt since it was returned by "get_distance_map", so that what has been read from it is consistent.
  *
- * @param width An integer number representing the chess board width.
- * @param height An integer number representing the chess board height.
+ * @param game_board The reference to the game board.
+ * @param distances The reference to the distance map, NULL on sparse boards.
+ * @param sequence The sequence of the map returned along with it.
  *
- * @return An integer number representing the ID of the shared memory segment where the game board has been allocated at.
+ * @return If the map has not changed will be returned "1", otherwise "0".
  */
-int generate_board(int width, int height){
-    unsigned int x, y, index;
-    board_t* game_board;
-    int shm_id;
+boolean is_distance_map_current(board_t* game_board, unsigned int* distances, unsigned int sequence){
+    if ( distances == NULL ){
+        return 1;
+    }
+    /* Entries must have been read before the sequence is checked again. */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&game_board->distance_map_sequences[distances == get_distance_maps(game_board) ? 0 : 1], __ATOMIC_RELAXED) == sequence ? 1 : 0;
+}
 
-    shm_id = allocate_board(width, height);
-    game_board = get_board(shm_id);
-    /* Set basic board attributes. */
-    game_board->width = width;
-    game_board->height = height;
-    game_board->coordinator_mq_id = generate_message_queue();
-    game_board->coordinator_pid = getpid();
-    game_board->waiting_time = game_board->round_in_progress = 0;
-    /* Initialize each board cell. */
-    for ( x = 0 ; x < width ; x++ ){
-        for ( y = 0 ; y < height ; y++ ){
-            index = compute_index_from_params(game_board, x, y);
-            game_board->cells[index].flag_score = 0;
-            game_board->cells[index].occupant_type = 0;
-            game_board->cells[index].player_pseudo_name = 0;
-            sem_init(&game_board->cells[index].mutex, 0, 1);
+/**
+ * Returns the pawn slots, each pawn owns the slot matching its placement order (pawn number * player count + player number).
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The reference to the first pawn slot.
+ */
+pawn_slot_t* get_pawn_slots(board_t* game_board){
+    return (pawn_slot_t*)( (char*)game_board + game_board->pawn_slots_offset );
+}
+
+/**
+ * Rebuilds the distance map with a breadth first search starting from all the uncaptured flags at once.
+ * The map is built aside and then published. Pawns may still be reading the one built two rebuilds earlier, so its sequence is made
+ * odd while it is rewritten and they read it again; only the master process may call it.
+ *
+ * @param game_board The reference to the game board.
+ */
+void update_distance_map(board_t* game_board){
+    unsigned int i, index, distance, head, tail, cell_count, next, *distances, *queue;
+    neighbours_t* neighbours;
+    unsigned char* counts;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        /* Pawns look for the nearest flag themselves. */
+        return;
+    }
+    cell_count = game_board->cell_count;
+    next = 1 - game_board->active_distance_map;
+    distances = get_distance_maps(game_board) + ( next * cell_count );
+    queue = get_distance_maps(game_board) + ( 2 * cell_count );
+    neighbours = get_neighbours(game_board);
+    counts = get_neighbour_counts(game_board);
+    begin_board_write(&game_board->distance_map_sequences[next]);
+    for ( i = 0 ; i < cell_count ; i++ ){
+        __atomic_store_n(&distances[i], DISTANCE_UNREACHABLE, __ATOMIC_RELAXED);
+    }
+    head = tail = 0;
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        if ( __atomic_load_n(&game_board->flags[i].owner, __ATOMIC_ACQUIRE) == 0 ){
+            __atomic_store_n(&distances[game_board->flags[i].index], 0, __ATOMIC_RELAXED);
+            queue[tail++] = game_board->flags[i].index;
         }
     }
-    return shm_id;
+    /* Pawns are not obstacles as they keep moving, every step costs the same and cells are queued in order of distance. */
+    while ( head < tail ){
+        index = queue[head++];
+        distance = distances[index] + 1;
+        for ( i = 0 ; i < counts[index] ; i++ ){
+            if ( distances[neighbours[index].cells[i]] == DISTANCE_UNREACHABLE ){
+                __atomic_store_n(&distances[neighbours[index].cells[i]], distance, __ATOMIC_RELAXED);
+                queue[tail++] = neighbours[index].cells[i];
+            }
+        }
+    }
+    end_board_write(&game_board->distance_map_sequences[next]);
+    __atomic_store_n(&game_board->active_distance_map, next, __ATOMIC_RELEASE);
 }
 
 /**
- * Returns the reference to the game board according to a given shared memory segment ID.
+ * Looks for the uncaptured flag closest to a given cell, it is where pawns head to on sparse boards as they have no distance map.
  *
- * @param shm_id An integer number representing he shared memory segment ID.
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell to start from.
+ * @param flag_index The reference to the variable where the index of the cell the flag is placed at will be stored at.
  *
- * @return A pointer to the game board that has been attached.
+ * @return If an uncaptured flag has been found will be returned "1", otherwise "0".
  */
-board_t* get_board(int shm_id){
-    board_t* game_board;
-    void* shm_ptr;
+boolean find_nearest_flag(board_t* game_board, unsigned int index, unsigned int* flag_index){
+    unsigned int i, distance, nearest_distance;
+    boolean found;
 
-    /* Attach the allocated shared memory segment. */
-    shm_ptr = shmat(shm_id, NULL, 0);
-    if ( (int)shm_ptr == -1 ){
-        printf("Cannot attach the shared memory segment, aborting.\n");
-        printf("Reported error: %s.\n", strerror(errno));
-        exit(2);
+    found = 0;
+    nearest_distance = DISTANCE_UNREACHABLE;
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        if ( __atomic_load_n(&game_board->flags[i].owner, __ATOMIC_ACQUIRE) != 0 ){
+            continue;
+        }
+        distance = compute_distance(game_board, index, game_board->flags[i].index);
+        if ( distance < nearest_distance ){
+            nearest_distance = distance;
+            *flag_index = game_board->flags[i].index;
+            found = 1;
+        }
     }
-    game_board = (board_t *)shm_ptr;
-    return game_board;
+    return found;
 }
 
 /**
- * Returns a couple of coordinates designating a free position in the game board picked randomly.
+ * Checks if all the flags placed during current round have been captured.
  *
  * @param game_board The reference to the game board.
- * @param allow_occupied_by_flags If set to "true" cells occupied by a flag will be considered as well as free ones.
  *
- * @return The coordinates found.
+ * @return If no flag is left will be returned "1", otherwise "0".
  */
-coords_t get_random_position(board_t* game_board, boolean allow_occupied_by_flags){
-    unsigned short min_occupant_type, current_occupant_type;
-    pid_t current_pid;
-    coords_t coords;
+boolean all_flags_captured(board_t* game_board){
+    unsigned int i, captured;
 
-    min_occupant_type = allow_occupied_by_flags == 1 ? 1 : 0;
-    current_pid = getpid();
-    srand(current_pid);
-    do {
-        /* Loop until a cell having entity type zero (no entity present) is found. */
-        coords.x = (int)lrand48() % game_board->width;
-        coords.y = (int)lrand48() % game_board->height;
-        /* Convert a 2D matrix index into a 1D array index. */
-        coords.index = compute_index(game_board, &coords);
-        current_occupant_type = game_board->cells[coords.index].occupant_type;
-    } while( current_occupant_type > min_occupant_type );
-    return coords;
+    captured = 0;
+    for ( i = 0 ; i < FLAG_BITMAP_WORDS ; i++ ){
+        captured += __builtin_popcountl(__atomic_load_n(&game_board->captured_flags[i], __ATOMIC_RELAXED));
+    }
+    return captured >= game_board->flag_count ? 1 : 0;
 }
 
 /**
- * Places a pawn on a given cell.
+ * Claims a given cell for a pawn, the cell is claimed atomically so that two pawns can never end up on the same cell.
  *
  * @param game_board The reference to the game board.
- * @param position The position where the pawn should be placed at.
+ * @param position The position of the cell to claim.
  * @param player_pseudo_name The pseudo name associated to the player this pawn belongs to.
  *
- * @return If a flag is already present in the given position it will be conquered and "1" will be returned.
+ * @return MOVE_BLOCKED if the cell is occupied by another pawn, MOVE_CAPTURED if a flag was present and has been conquered, MOVE_DONE otherwise.
+ *
+ * @private
  */
-boolean place_pawn(board_t* game_board, coords_t* position, char player_pseudo_name){
-    boolean has_conquered_flag;
+unsigned short claim_cell(board_t* game_board, coords_t* position, char player_pseudo_name){
+    cell_t current_cell, new_cell, *cell;
 
-    has_conquered_flag = 0;
-    sem_wait(&game_board->cells[position->index].mutex);
-    if ( game_board->cells[position->index].occupant_type == 0 ){
-        game_board->cells[position->index].occupant_type = 2;
-        game_board->cells[position->index].player_pseudo_name = player_pseudo_name;
-    }else if ( game_board->cells[position->index].occupant_type == 1 ){
-        game_board->cells[position->index].occupant_type = 2;
-        game_board->cells[position->index].player_pseudo_name = player_pseudo_name;
-        has_conquered_flag = 1;
+    cell = get_cell(game_board, position->index);
+    current_cell = __atomic_load_n(cell, __ATOMIC_RELAXED);
+    do {
+        if ( CELL_OCCUPANT_TYPE(current_cell) == 2 ){
+            return MOVE_BLOCKED;
+        }
+        /* Keep the flag score, the cell now belongs to the player. */
+        new_cell = MAKE_CELL(2, player_pseudo_name, CELL_FLAG_SCORE(current_cell));
+        if ( __atomic_compare_exchange_n(cell, &current_cell, new_cell, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) ){
+            break;
+        }
+        /* The cell has changed meanwhile, retries are counted as contention. */
+        TELEMETRY_COUNT(game_board->telemetry.claim_retries);
+    } while (1);
+    /* The bitboard is updated once the cell has been claimed, it is a view of the cells and never guards them. */
+    set_bitboard_cell(game_board, BITBOARD_OCCUPIED, position->index);
+    if ( CELL_OCCUPANT_TYPE(current_cell) == 1 ){
+        /* Only the pawn that won the cell gets here, so the flag is recorded as conquered exactly once. */
+        capture_flag(game_board, position->index, player_pseudo_name);
+        return MOVE_CAPTURED;
     }
-    sem_post(&game_board->cells[position->index].mutex);
-    return has_conquered_flag;
+    return MOVE_DONE;
 }
 
 /**
- * Checks if a pawn can be placed in a given position.
+ * Places a pawn on a given cell, the cell is claimed atomically so that two pawns can never end up on the same cell.
  *
  * @param game_board The reference to the game board.
- * @param position The position where the pawn is going to be placed at.
+ * @param position The position where the pawn should be placed at.
+ * @param player_pseudo_name The pseudo name associated to the player this pawn belongs to.
+ * @param slot The slot of the pawn, no other pawn may be using it.
  *
- * @return If the pawn can be placed will be returned "1".
+ * @return MOVE_BLOCKED if the cell is occupied by another pawn, MOVE_CAPTURED if a flag was present and has been conquered, MOVE_DONE otherwise.
  */
-boolean is_allowed_position(board_t* game_board, coords_t* position){
-    boolean is_allowed;
+unsigned short place_pawn(board_t* game_board, coords_t* position, char player_pseudo_name, unsigned int slot){
+    unsigned int* sequence;
+    unsigned short result;
 
-    sem_wait(&game_board->cells[position->index].mutex);
-    is_allowed = game_board->cells[position->index].occupant_type <= 1 ? 1 : 0;
-    sem_post(&game_board->cells[position->index].mutex);
-    return is_allowed;
+    sequence = &get_pawn_slots(game_board)[slot].sequence;
+    begin_board_write(sequence);
+    result = claim_cell(game_board, position, player_pseudo_name);
+    end_board_write(sequence);
+    return result;
 }
 
 /**
- * Moves a pawn from the given current position to a new one.
+ * Moves a pawn from the given current position to a new one: the new cell is claimed first, then the old one is released.
  *
- * @param game_board
+ * @param game_board The reference to the game board.
  * @param old_position Current pawn position.
  * @param new_position The position where the pawn should be moved to.
  * @param player_pseudo_name The pseudo name associated to the player this pawn belongs to.
+ * @param slot The slot of the pawn, no other pawn may be using it.
  *
- * @return IF the pawn has been moved to a cell where a flag was present will be returned "1" as that flag has been captured.
+ * @return MOVE_BLOCKED if the new cell is occupied, MOVE_CAPTURED if the pawn has been moved to a cell where a flag was present, MOVE_DONE otherwise.
  */
-boolean move_pawn(board_t* game_board, coords_t* old_position, coords_t* new_position, char player_pseudo_name){
-    boolean has_conquered_flag;
-    struct timespec wait;
+unsigned short move_pawn(board_t* game_board, coords_t* old_position, coords_t* new_position, char player_pseudo_name, unsigned int slot){
+    unsigned int* sequence;
+    unsigned short result;
 
-    has_conquered_flag = 0;
-    wait.tv_sec = 0;
-    wait.tv_nsec = game_board->waiting_time;
-    if ( is_allowed_position(game_board, new_position) == 1 ){
-        sem_wait(&game_board->cells[old_position->index].mutex);
-        game_board->cells[old_position->index].occupant_type = 0;
-        game_board->cells[old_position->index].player_pseudo_name = 0;
-        sem_post(&game_board->cells[old_position->index].mutex);
-        has_conquered_flag = place_pawn(game_board, new_position, player_pseudo_name);
+    /* Both cells change within the same write, a snapshot never shows the pawn on both of them. */
+    sequence = &get_pawn_slots(game_board)[slot].sequence;
+    begin_board_write(sequence);
+    result = claim_cell(game_board, new_position, player_pseudo_name);
+    if ( result != MOVE_BLOCKED ){
+        /* Unmark the old cell before releasing it, otherwise the mark set by the next pawn claiming it could be lost. */
+        clear_bitboard_cell(game_board, BITBOARD_OCCUPIED, old_position->index);
+        /* Only the occupant fields are cleared, the score of a flag conquered there stays in place. */
+        __atomic_and_fetch(get_cell(game_board, old_position->index), ~(cell_t)CELL_OCCUPANT_MASK, __ATOMIC_RELEASE);
     }
-    nanosleep(&wait, NULL);
-    return has_conquered_flag;
+    end_board_write(sequence);
+    return result;
+}
+
+/**
+ * Makes the calling pawn hold its position for the amount of time the game board has been configured with.
+ * The hold is cut short by control events (round released or closed, pawns woken up to check their messages).
+ *
+ * @param game_board The reference to the game board.
+ * @param control_generation The last control generation seen by the pawn.
+ */
+void hold_position(board_t* game_board, unsigned int control_generation){
+    wait_for_control_event(game_board, control_generation, game_board->waiting_time);
+}
+
+/**
+ * Draws the positions of the given amount of pawns on a sparse game board and stores them in the pawn slots, cells drawn twice are drawn again.
+ *
+ * @param game_board The reference to the game board.
+ * @param pawn_total The amount of positions to draw, one for each pawn of each player.
+ *
+ * @return The amount of positions drawn, it is lower than requested only if the board is almost full.
+ *
+ * @private
+ */
+unsigned int plan_sparse_pawn_placement(board_t* game_board, unsigned int pawn_total){
+    unsigned int i, draws, capacity, bucket, *drawn;
+    pawn_slot_t* pawn_slots;
+    coords_t position;
+
+    pawn_total = pawn_total > game_board->pawn_slot_count ? game_board->pawn_slot_count : pawn_total;
+    /* The cells drawn so far are kept in an open addressing set that is never more than half full. */
+    capacity = 1;
+    while ( capacity < pawn_total * 2 ){
+        capacity <<= 1;
+    }
+    drawn = (unsigned int*)calloc(capacity, sizeof(unsigned int));
+    if ( drawn == NULL ){
+        printf("Cannot allocate the placement plan, aborting.\n");
+        exit(1);
+    }
+    pawn_slots = get_pawn_slots(game_board);
+    i = draws = 0;
+    while ( i < pawn_total && draws < pawn_total * 4 + BOARD_SPARSE_FREE_CELL_DRAWS ){
+        draws++;
+        if ( draw_free_position(game_board, &position, &game_board->generator) == 0 ){
+            break;
+        }
+        bucket = ( position.index * 2654435761U ) & ( capacity - 1 );
+        while ( drawn[bucket] != 0 && drawn[bucket] != position.index + 1 ){
+            bucket = ( bucket + 1 ) & ( capacity - 1 );
+        }
+        if ( drawn[bucket] == 0 ){
+            drawn[bucket] = position.index + 1;
+            pawn_slots[i++].position = position.index;
+        }
+    }
+    free(drawn);
+    game_board->planned_positions = i;
+    return i;
+}
+
+/**
+ * Draws the positions of the given amount of pawns from the free cell set, in the same order pawns would be placed in turns.
+ * Drawn cells are swapped to the tail of the set so that the plan is stored in the set itself until it is rebuilt.
+ *
+ * @param game_board The reference to the game board.
+ * @param pawn_total The amount of positions to draw, one for each pawn of each player.
+ *
+ * @return The amount of positions drawn, it is lower than requested only if the board is full.
+ */
+unsigned int plan_pawn_placement(board_t* game_board, unsigned int pawn_total){
+    unsigned int i, slot, index, *free_cells;
+
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        return plan_sparse_pawn_placement(game_board, pawn_total);
+    }
+    free_cells = get_free_cells(game_board);
+    lock_free_cells(game_board);
+    game_board->placement_plan_end = game_board->free_cell_count;
+    for ( i = 0 ; i < pawn_total && game_board->free_cell_count > 0 ; i++ ){
+        slot = random_below(&game_board->generator, game_board->free_cell_count);
+        game_board->free_cell_count--;
+        index = free_cells[slot];
+        free_cells[slot] = free_cells[game_board->free_cell_count];
+        free_cells[game_board->free_cell_count] = index;
+    }
+    game_board->planned_positions = i;
+    unlock_free_cells(game_board);
+    return i;
+}
+
+/**
+ * Returns the position drawn for a given pawn by "plan_pawn_placement".
+ *
+ * @param game_board The reference to the game board.
+ * @param slot The number of the pawn in placement order (pawn number * player count + player number).
+ * @param position The reference to the coordinates where the position will be stored at.
+ *
+ * @return If a position has been drawn for the given pawn will be returned "1", otherwise "0".
+ */
+boolean get_planned_position(board_t* game_board, unsigned int slot, coords_t* position){
+    if ( slot >= game_board->planned_positions ){
+        return 0;
+    }
+    if ( game_board->layout == BOARD_LAYOUT_SPARSE ){
+        /* The plan is stored in the pawn slots, the pawn will publish the same position once placed. */
+        compute_coords(game_board, get_pawn_slots(game_board)[slot].position, position);
+        return 1;
+    }
+    position->index = get_free_cells(game_board)[game_board->placement_plan_end - 1 - slot];
+    compute_coords(game_board, position->index, position);
+    return 1;
 }
 
 /**
@@ -279,22 +1631,40 @@ boolean move_pawn(board_t* game_board, coords_t* old_position, coords_t* new_pos
 unsigned int spawn_flags(board_t* game_board, unsigned int min, unsigned int max, unsigned int max_score){
     unsigned int i, flag_count, n, score;
     coords_t position;
+    cell_t empty_cell;
 
+    /* The flag index in the game board has a fixed capacity. */
+    max = max > MAX_FLAGS ? MAX_FLAGS : max;
+    min = min > max ? max : min;
     /* Generate the flag count. */
-    flag_count = (int)lrand48() % ( max + 1 - min ) + min;
+    flag_count = random_below(&game_board->generator, max + 1 - min) + min;
     n = flag_count;
+    /* Pawns have moved since the set was last built. */
+    rebuild_free_cells(game_board);
+    /* Flags appear all at once in snapshots. */
+    begin_board_write(&game_board->sequence);
     for ( i = 0 ; i < flag_count ; i++ ){
         /* Generate the score value for this flag. */
-        score = (int)lrand48() % ( max_score - n ) + 1;
+        score = random_below(&game_board->generator, max_score - n) + 1;
         max_score -= score;
         n--;
-        /* Generate a random position where this flag should be placed at. */
-        position = get_random_position(game_board, 0);
-        /* Place the flag on the board, dont use a semaphore as this method is used when no pawn is moving. */
-        game_board->cells[position.index].occupant_type = 1;
-        game_board->cells[position.index].player_pseudo_name = 0;
-        game_board->cells[position.index].flag_score = score;
+        /* Pick a random free position and place the flag there, a pawn may have taken the cell meanwhile. */
+        do {
+            if ( take_free_position(game_board, &position, &game_board->generator) == 0 ){
+                printf("Cannot place the flag as the game board is full, aborting.\n");
+                exit(3);
+            }
+            empty_cell = 0;
+        } while ( !__atomic_compare_exchange_n(get_cell(game_board, position.index), &empty_cell, MAKE_CELL(1, 0, score), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) );
+        set_bitboard_cell(game_board, BITBOARD_OCCUPIED, position.index);
+        /* Add the flag to the index used for scoring and cleanup. */
+        game_board->flags[i].index = position.index;
+        game_board->flags[i].score = score;
+        game_board->flags[i].owner = 0;
     }
+    game_board->flag_count = flag_count;
+    end_board_write(&game_board->sequence);
+    update_distance_map(game_board);
     return flag_count;
 }
 
@@ -304,65 +1674,12 @@ unsigned int spawn_flags(board_t* game_board, unsigned int min, unsigned int max
  * @param game_board The reference to the game board.
  */
 void print_board(board_t* game_board){
-    unsigned int x, y, index;
+    renderer_t* renderer;
 
-    /* Print the x axis. */
-    printf("\n    ");
-    for ( x = 1 ; x <= game_board->width ; x++ ){
-        if ( x < 100 && x >= 10 ){
-            printf("| 0%d", x);
-        }else if ( x < 10 ){
-            printf("| 00%d", x);
-        }else{
-            printf("| %d", x);
-        }
-    }
-    printf("|\n    |");
-    /* Print the separator after the x axis header. */
-    for ( x = 1 ; x <= game_board->width ; x++ ){
-        printf(x == 1 ? "----" : "-----");
-    }
-    printf("|\n");
-    for ( y = 0 ; y < game_board->height ; y++ ){
-        /* Print the left block of the y axis. */
-        if ( y < 99 && y >= 9 ){
-            printf(" 0%d", y + 1);
-        }else if ( y < 9 ){
-            printf(" 00%d", y + 1);
-        }else{
-            printf(" %d", y + 1);
-        }
-        /* Print a whole row. */
-        for ( x = 0 ; x < game_board->width ; x++ ){
-            index = compute_index_from_params(game_board, x, y);
-            switch ( game_board->cells[index].occupant_type ){
-                case 0: {
-                    /* This is an empty cell. */
-                    printf("|    ");
-                }break;
-                case 1: {
-                    /* This cell contains a flag. */
-                    if ( game_board->cells[index].player_pseudo_name > 0 ){
-                        /* This flag has been conquered by a process. */
-                        printf("|\033[1;34♟\033[0m-\033[31m⚑%c \033[0m", game_board->cells[index].player_pseudo_name);
-                    }else{
-                        printf("|  \033[34m⚑\033[0m ");
-                    }
-                }break;
-                case 2: {
-                    /* This cell contains a pawn. */
-                    printf("| \033[1;34♟\033[0m%c ", game_board->cells[index].player_pseudo_name);
-                }break;
-            }
-        }
-        printf("|\n    |");
-        /* Print the row separator. */
-        for ( x = 0 ; x <= game_board->width ; x++ ){
-            printf(x == 0 ? "" : ( x == 2 ? "----" : "-----" ));
-        }
-        printf("|\n");
-    }
-    printf("\n");
+    /* The whole frame is built in memory and written out at once rather than printing every cell on its own. */
+    renderer = create_renderer(game_board, STDOUT_FILENO, 0);
+    render_board(renderer, game_board);
+    destroy_renderer(renderer);
 }
 
 /**
@@ -373,30 +1690,14 @@ void print_board(board_t* game_board){
  * @param player_count An integer number representing the number of players spawned.
  */
 void print_stats(board_t* game_board, player_t* player_list, unsigned int player_count){
-    unsigned int x, y, i, index, player_index;
-    unsigned int scores[player_count];
+    unsigned int i;
 
-    /* Iterate the whole game board. */
-    for ( y = 0 ; y < game_board->height ; y++ ){
-        for ( x = 0 ; x < game_board->width ; x++ ){
-            index = compute_index_from_params(game_board, x, y);
-            /* Check if current cell is owned by a player. */
-            if ( game_board->cells[index].player_pseudo_name != 0 ){
-                /* Find out which player own current cell. */
-                player_index = get_player_index(player_list, player_count, game_board->cells[index].player_pseudo_name);
-                if ( player_index != -1 ){
-                    /* Increment the player found's score. */
-                    scores[player_index] += game_board->cells[index].flag_score;
-                }
-            }
-        }
-    }
     printf("Round stats: \n");
-    /* Print the stats for each player. */
+    /* Print the stats for each player, scores come from the flag index. */
     for ( i = 0 ; i < player_count ; i++ ){
         printf("Player %c:\n", player_list[i].pseudo_name);
-        printf("\tScore: %d.\n", scores[i]);
-        printf("\tRemaining moves: %d.\n\n", scores[i]);
+        printf("\tScore: %d.\n", get_player_score(game_board, player_list[i].pseudo_name));
+        printf("\tRemaining moves: %d.\n\n", player_list[i].available_moves);
     }
     printf("\n");
 }
@@ -449,24 +1750,26 @@ void print_metrics(player_t* player_list, unsigned int player_count, unsigned in
 }
 
 /**
- * Deallocates each semaphore assigned to cells and the message queue assigned to the master process.
+ * Deallocates the message queue assigned to the master process and releases the shared memory segment, the game board cannot be used afterwards.
  *
  * @param game_board The reference to the game board.
  */
 void destroy_board(board_t* game_board){
-    unsigned int length, i;
-
-    length = game_board->width * game_board->height;
-    /* Iterate each board cell and deallocate the corresponding semaphore. */
-    for ( i = 0 ; i < length ; i++ ){
-        if ( sem_destroy(&game_board->cells[i].mutex) == -1 ){
-            printf("Cannot destroy the semaphore, aborting.\n");
-            printf("Reported error: %s.\n", strerror(errno));
-            exit(5);
+    int segment_id;
+
+    /* Deallocate the message queue assigned to the master process, an in-process one vanishes along with the process. */
+    if ( game_board->execution_mode == EXECUTION_MODE_PROCESS ){
+        close_message_queue(game_board->coordinator_mq_id);
+        segment_id = game_board->segment_id;
+        if ( game_board->allocator == BOARD_ALLOCATOR_SYSV ){
+            /* The segment is removed once the last process attached to it is gone. */
+            shmctl(segment_id, IPC_RMID, NULL);
+            shmdt(game_board);
+        }else{
+            munmap(game_board, game_board->segment_size);
+            close(segment_id);
         }
     }
-    /* Deallocate the message queue assigned to the master process. */
-    close_message_queue(game_board->coordinator_mq_id);
 }
 
 /**
@@ -475,14 +1778,25 @@ void destroy_board(board_t* game_board){
  * @param game_board The reference to the game board.
  */
 void remove_flags(board_t* game_board){
-    unsigned int length, i;
+    cell_t current_cell, new_cell, *cell;
+    unsigned int i, index;
 
-    length = game_board->width * game_board->height;
-    for ( i = 0 ; i < length ; i++ ){
-        if ( game_board->cells[i].occupant_type == 1 ){
-            game_board->cells[i].occupant_type = 0;
+    /* Only the cells listed in the flag index are visited, pawns that were already moving when the round was closed may still claim them. */
+    begin_board_write(&game_board->sequence);
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        index = game_board->flags[i].index;
+        cell = get_cell(game_board, index);
+        current_cell = __atomic_load_n(cell, __ATOMIC_RELAXED);
+        do {
+            /* A flag left is removed, a pawn standing there only loses the score assigned to the cell. */
+            new_cell = CELL_OCCUPANT_TYPE(current_cell) == 1 ? 0 : current_cell & CELL_OCCUPANT_MASK;
+        } while ( !__atomic_compare_exchange_n(cell, &current_cell, new_cell, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) );
+        if ( new_cell == 0 ){
+            /* The mark of a pawn claiming the cell right after may be lost, the free cell set is only a hint as cells are claimed atomically. */
+            clear_bitboard_cell(game_board, BITBOARD_OCCUPIED, index);
         }
-        /* Remove the score assigned to the cell (flag or conquered flag). */
-        game_board->cells[i].flag_score = 0;
     }
+    game_board->flag_count = 0;
+    memset(game_board->captured_flags, 0, sizeof(game_board->captured_flags));
+    end_board_write(&game_board->sequence);
 }
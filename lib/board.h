@@ -3,19 +3,44 @@
 
 #include "types.h"
 
+unsigned short move_pawn(board_t* game_board, coords_t* old_position, coords_t* new_position, char player_pseudo_name, unsigned int slot);
 void print_metrics(player_t* player_list, unsigned int player_count, unsigned int rounds, unsigned int total_playing_time);
-boolean move_pawn(board_t* game_board, coords_t* old_position, coords_t* new_position, char player_pseudo_name);
+board_t* generate_board(int width, int height, unsigned short layout, unsigned short allocator, unsigned short huge_pages);
+unsigned short place_pawn(board_t* game_board, coords_t* position, char player_pseudo_name, unsigned int slot);
+board_t* generate_local_board(int width, int height, unsigned short execution_mode, unsigned short layout);
 unsigned int spawn_flags(board_t* game_board, unsigned int min, unsigned int max, unsigned int max_score);
+boolean is_distance_map_current(board_t* game_board, unsigned int* distances, unsigned int sequence);
+unsigned int take_board_snapshot(board_t* game_board, board_t* snapshot, unsigned int max_attempts);
 unsigned int compute_index_from_params(board_t* game_board, unsigned int x, unsigned int y);
 void print_status(board_t* game_board, player_t* player_list, unsigned int player_count);
+void clear_bitboard_cell(board_t* game_board, unsigned int bitboard, unsigned int index);
+boolean get_planned_position(board_t* game_board, unsigned int slot, coords_t* position);
+boolean take_free_position(board_t* game_board, coords_t* position, random_t* generator);
 void print_stats(board_t* game_board, player_t* player_list, unsigned int player_count);
-boolean place_pawn(board_t* game_board, coords_t* position, char player_pseudo_name);
-coords_t get_random_position(board_t* game_board, boolean allow_occupied_by_flags);
+void set_bitboard_cell(board_t* game_board, unsigned int bitboard, unsigned int index);
+unsigned int compute_distance(board_t* game_board, unsigned int from, unsigned int to);
+unsigned int plan_pawn_placement(board_t* game_board, unsigned int pawn_total);
+void compute_coords(board_t* game_board, unsigned int index, coords_t* coords);
+unsigned int* get_distance_map(board_t* game_board, unsigned int* sequence);
+bitboard_word_t* get_bitboard(board_t* game_board, unsigned int bitboard);
+void hold_position(board_t* game_board, unsigned int control_generation);
 unsigned int compute_index(board_t* game_board, coords_t* coords);
-int generate_board(int width, int height);
+void seed_board(board_t* game_board, unsigned long seed);
+unsigned char* get_neighbour_counts(board_t* game_board);
+neighbours_t* get_neighbours(board_t* game_board);
+pawn_slot_t* get_pawn_slots(board_t* game_board);
+boolean all_flags_captured(board_t* game_board);
+void update_distance_map(board_t* game_board);
+void rebuild_free_cells(board_t* game_board);
+board_t* attach_board(const char* segment);
 void destroy_board(board_t* game_board);
 void remove_flags(board_t* game_board);
 void print_board(board_t* game_board);
-board_t* get_board(int shm_id);
+void clear_board(board_t* game_board);
+
+unsigned int get_cell_neighbours(board_t* game_board, unsigned int index, neighbours_t* neighbours);
+boolean find_nearest_flag(board_t* game_board, unsigned int index, unsigned int* flag_index);
+cell_t load_cell(board_t* game_board, unsigned int index);
+cell_t* get_cell(board_t* game_board, unsigned int index);
 
 #endif
@@ -1,13 +1,171 @@
+#define _GNU_SOURCE
+
 #include "communicator.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/msg.h>
 #include <errno.h>
 #include <string.h>
 
+#if __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
+
 #include "types.h"
 
+/**
+ * The maximum number of in-process message queues that can be allocated during a game.
+ */
+#define MAX_LOCAL_MESSAGE_QUEUES 65536
+
+/**
+ * The in-process message queues, a queue having index "i" is identified by the ID "-(i + 1)".
+ */
+mailbox_t* local_message_queues[MAX_LOCAL_MESSAGE_QUEUES];
+
+/**
+ * The amount of in-process message queues allocated so far.
+ */
+unsigned int local_message_queue_count = 0;
+
+/**
+ * Puts the calling process to sleep as long as the given word contains the expected value.
+ *
+ * @param address The address of the word to watch, it can live in shared memory.
+ * @param expected The value the word must contain for the process to go to sleep.
+ * @param timeout The maximum amount of time to sleep for, if NULL the process sleeps until woken up.
+ */
+void wait_on_word(unsigned int* address, unsigned int expected, struct timespec* timeout){
+#if __linux__
+    syscall(SYS_futex, address, FUTEX_WAIT, expected, timeout, NULL, 0);
+#else
+    struct timespec wait;
+
+    /* No futex available, just back off for a while and let the caller check again. */
+    wait.tv_sec = 0;
+    wait.tv_nsec = timeout != NULL && timeout->tv_sec == 0 && timeout->tv_nsec < 50000 ? timeout->tv_nsec : 50000;
+    if ( __atomic_load_n(address, __ATOMIC_ACQUIRE) == expected ){
+        nanosleep(&wait, NULL);
+    }
+#endif
+}
+
+/**
+ * Wakes up the processes sleeping on the given word.
+ *
+ * @param address The address of the word processes are sleeping on.
+ * @param count The maximum amount of processes to wake up.
+ */
+void wake_on_word(unsigned int* address, int count){
+#if __linux__
+    syscall(SYS_futex, address, FUTEX_WAKE, count, NULL, NULL, 0);
+#endif
+}
+
+/**
+ * Returns the current value of the monotonic clock, it is shared by all the processes of the game.
+ *
+ * @return The amount of nanoseconds elapsed since an arbitrary point in time.
+ */
+unsigned long get_monotonic_nanoseconds(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000000UL + (unsigned long)now.tv_nsec;
+}
+
+/**
+ * Releases a new round: all the pawns waiting on the control generation of the game board are woken up at once.
+ * Pawns cannot move before the round is released as it is marked as in progress only here.
+ *
+ * @param game_board The reference to the game board.
+ */
+void release_round(board_t* game_board){
+    /* Read by pawns and by "prochess-stat" at any time, hence the atomic stores. */
+    __atomic_store_n(&game_board->round_start_latency_total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&game_board->round_start_latency_max, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&game_board->round_started_pawns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&game_board->round_release_time, get_monotonic_nanoseconds(), __ATOMIC_RELAXED);
+    __atomic_store_n(&game_board->round_in_progress, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&game_board->telemetry.rounds, 1, __ATOMIC_RELAXED);
+    /* Publishing the new generation makes the fields above visible to the pawns reading it. */
+    __atomic_add_fetch(&game_board->control_generation, 1, __ATOMIC_RELEASE);
+    wake_on_word(&game_board->control_generation, 0x7fffffff);
+}
+
+/**
+ * Ends current round: pawns holding their position are woken up and stop playing right away.
+ *
+ * @param game_board The reference to the game board.
+ */
+void close_round(board_t* game_board){
+    __atomic_store_n(&game_board->round_in_progress, 0, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&game_board->control_generation, 1, __ATOMIC_RELEASE);
+    wake_on_word(&game_board->control_generation, 0x7fffffff);
+}
+
+/**
+ * Wakes up all the pawns waiting for a round so that they check their messages, without releasing a round.
+ *
+ * @param game_board The reference to the game board.
+ */
+void wake_pawns(board_t* game_board){
+    /* The generation changes so that a pawn about to go to sleep notices it as well. */
+    __atomic_add_fetch(&game_board->control_generation, 1, __ATOMIC_RELEASE);
+    wake_on_word(&game_board->control_generation, 0x7fffffff);
+}
+
+/**
+ * Puts the calling pawn to sleep until the control generation of the game board changes, that is until a round is released
+ * or closed or the pawns are woken up to check their messages.
+ *
+ * @param game_board The reference to the game board.
+ * @param generation The last control generation seen by the pawn.
+ * @param timeout The maximum amount of nanoseconds to sleep for, if negative the pawn sleeps until the generation changes.
+ *
+ * @return If the generation has changed will be returned "1", if the timeout has expired "0".
+ */
+boolean wait_for_control_event(board_t* game_board, unsigned int generation, long timeout){
+    unsigned long deadline, now;
+    struct timespec remaining;
+
+    deadline = timeout >= 0 ? get_monotonic_nanoseconds() + (unsigned long)timeout : 0;
+    while ( __atomic_load_n(&game_board->control_generation, __ATOMIC_ACQUIRE) == generation ){
+        if ( timeout < 0 ){
+            wait_on_word(&game_board->control_generation, generation, NULL);
+            continue;
+        }
+        now = get_monotonic_nanoseconds();
+        if ( now >= deadline ){
+            return 0;
+        }
+        /* Futex timeouts are relative, wake ups may be spurious so the remaining time is computed each time. */
+        remaining.tv_sec = ( deadline - now ) / 1000000000;
+        remaining.tv_nsec = ( deadline - now ) % 1000000000;
+        wait_on_word(&game_board->control_generation, generation, &remaining);
+    }
+    return 1;
+}
+
+/**
+ * Accounts the time elapsed between the release of current round and the first move of the calling pawn.
+ *
+ * @param game_board The reference to the game board.
+ */
+void record_round_start(board_t* game_board){
+    unsigned long latency, max;
+
+    latency = get_monotonic_nanoseconds() - __atomic_load_n(&game_board->round_release_time, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&game_board->round_start_latency_total, latency, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&game_board->round_started_pawns, 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&game_board->round_start_latency_max, __ATOMIC_RELAXED);
+    while ( latency > max && !__atomic_compare_exchange_n(&game_board->round_start_latency_max, &max, latency, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+}
+
 /**
  * Initializes a new message queue.
  *
@@ -26,6 +184,166 @@ int generate_message_queue(){
     return message_queue_id;
 }
 
+/**
+ * Initializes a new message queue that can only be used by threads living in current process.
+ *
+ * @return An integer number lower than zero representing the message queue ID.
+ */
+int generate_local_message_queue(){
+    mailbox_t* mailbox;
+    unsigned int index;
+
+    index = __atomic_fetch_add(&local_message_queue_count, 1, __ATOMIC_RELAXED);
+    mailbox = (mailbox_t*)malloc(sizeof(mailbox_t));
+    if ( index >= MAX_LOCAL_MESSAGE_QUEUES || mailbox == NULL ){
+        printf("Cannot initialize a new message queue, aborting.\n");
+        exit(2);
+    }
+    pthread_mutex_init(&mailbox->mutex, NULL);
+    pthread_cond_init(&mailbox->not_empty, NULL);
+    mailbox->head = mailbox->count = 0;
+    mailbox->capacity = 8;
+    mailbox->on_message = NULL;
+    mailbox->on_message_argument = NULL;
+    mailbox->messages = (message_t*)malloc(sizeof(message_t) * mailbox->capacity);
+    if ( mailbox->messages == NULL ){
+        printf("Cannot initialize a new message queue, aborting.\n");
+        exit(2);
+    }
+    __atomic_store_n(&local_message_queues[index], mailbox, __ATOMIC_RELEASE);
+    return -(int)index - 1;
+}
+
+/**
+ * Initializes a new message queue suitable for the execution mode the game board has been configured with.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return An integer number representing the message queue ID.
+ */
+int open_message_queue(board_t* game_board){
+    if ( game_board->execution_mode == EXECUTION_MODE_PROCESS ){
+        return generate_message_queue();
+    }
+    return generate_local_message_queue();
+}
+
+/**
+ * Returns the in-process message queue identified by the given ID.
+ *
+ * @param mq_id An integer number lower than zero representing the message queue ID.
+ *
+ * @return The reference to the message queue.
+ *
+ * @private
+ */
+mailbox_t* get_local_message_queue(int mq_id){
+    return __atomic_load_n(&local_message_queues[-mq_id - 1], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Appends a given message to the given in-process message queue, the queue grows whenever it is full.
+ *
+ * @param mailbox The reference to the message queue.
+ * @param msg The reference to the message to send.
+ *
+ * @private
+ */
+void local_send_message(mailbox_t* mailbox, message_t* msg){
+    message_t* messages;
+    unsigned int i;
+
+    pthread_mutex_lock(&mailbox->mutex);
+    if ( mailbox->count == mailbox->capacity ){
+        /* Move the queued messages to a larger buffer preserving their order. */
+        messages = (message_t*)malloc(sizeof(message_t) * mailbox->capacity * 2);
+        if ( messages == NULL ){
+            printf("Cannot send the message, aborting (%d).\n", msg->message_type);
+            exit(4);
+        }
+        for ( i = 0 ; i < mailbox->count ; i++ ){
+            messages[i] = mailbox->messages[( mailbox->head + i ) % mailbox->capacity];
+        }
+        free(mailbox->messages);
+        mailbox->messages = messages;
+        mailbox->head = 0;
+        mailbox->capacity *= 2;
+    }
+    mailbox->messages[( mailbox->head + mailbox->count ) % mailbox->capacity] = *msg;
+    mailbox->count++;
+    pthread_cond_signal(&mailbox->not_empty);
+    pthread_mutex_unlock(&mailbox->mutex);
+    if ( mailbox->on_message != NULL ){
+        /* Let the watcher know there is something to read. */
+        mailbox->on_message(mailbox->on_message_argument);
+    }
+}
+
+/**
+ * Pops a message from the given in-process message queue, the caller will sleep until a message is available.
+ *
+ * @param mailbox The reference to the message queue.
+ *
+ * @return The message extracted.
+ *
+ * @private
+ */
+message_t local_receive_message(mailbox_t* mailbox){
+    message_t msg;
+
+    pthread_mutex_lock(&mailbox->mutex);
+    while ( mailbox->count == 0 ){
+        pthread_cond_wait(&mailbox->not_empty, &mailbox->mutex);
+    }
+    msg = mailbox->messages[mailbox->head];
+    mailbox->head = ( mailbox->head + 1 ) % mailbox->capacity;
+    mailbox->count--;
+    pthread_mutex_unlock(&mailbox->mutex);
+    return msg;
+}
+
+/**
+ * Pops a message from the given in-process message queue, if any.
+ *
+ * @param mailbox The reference to the message queue.
+ * @param msg The reference to the message the extracted one will be copied into.
+ *
+ * @return If a message has been extracted will be returned "1".
+ *
+ * @private
+ */
+boolean local_poll_message(mailbox_t* mailbox, message_t* msg){
+    boolean found;
+
+    found = 0;
+    pthread_mutex_lock(&mailbox->mutex);
+    if ( mailbox->count > 0 ){
+        *msg = mailbox->messages[mailbox->head];
+        mailbox->head = ( mailbox->head + 1 ) % mailbox->capacity;
+        mailbox->count--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&mailbox->mutex);
+    return found;
+}
+
+/**
+ * Registers a function that will be called whenever a message is sent to the given in-process message queue.
+ *
+ * @param mq_id An integer number lower than zero representing the message queue ID.
+ * @param on_message The function to call, it must not block.
+ * @param argument The argument that will be passed to the function.
+ */
+void watch_message_queue(int mq_id, void (*on_message)(void*), void* argument){
+    mailbox_t* mailbox;
+
+    mailbox = get_local_message_queue(mq_id);
+    pthread_mutex_lock(&mailbox->mutex);
+    mailbox->on_message_argument = argument;
+    mailbox->on_message = on_message;
+    pthread_mutex_unlock(&mailbox->mutex);
+}
+
 /**
  * Sends a given message to the given message queue.
  *
@@ -36,6 +354,11 @@ void send_message(int mq_id, message_t* msg){
     size_t size;
     int result;
 
+    if ( mq_id < 0 ){
+        /* This is an in-process message queue. */
+        local_send_message(get_local_message_queue(mq_id), msg);
+        return;
+    }
     /* Get the length of the payload string. */
     size = strlen(msg->payload) + 1;
     /* Send the message. */
@@ -59,18 +382,66 @@ message_t receive_message(int mq_id){
     message_t msg;
     int result;
 
+    if ( mq_id < 0 ){
+        /* This is an in-process message queue. */
+        return local_receive_message(get_local_message_queue(mq_id));
+    }
     /* Receive the message from the message queue. */
     result = msgrcv(mq_id, &msg, 8196, 0, 0);
     if ( result == -1 ){}
     return msg;
 }
 
+/**
+ * Pops a message from the given message queue without waiting if the queue is empty.
+ *
+ * @param mq_id An integer number representing he ID of the message queue.
+ * @param msg The reference to the message the extracted one will be copied into.
+ *
+ * @return If a message has been extracted will be returned "1".
+ */
+boolean poll_message(int mq_id, message_t* msg){
+    if ( mq_id < 0 ){
+        /* This is an in-process message queue. */
+        return local_poll_message(get_local_message_queue(mq_id), msg);
+    }
+    return msgrcv(mq_id, msg, sizeof(message_t) - sizeof(long), 0, IPC_NOWAIT | MSG_NOERROR) == -1 ? 0 : 1;
+}
+
+/**
+ * Returns the amount of messages waiting in the given message queue, any process can read it without taking messages out.
+ *
+ * @param mq_id An integer number representing he ID of the message queue.
+ *
+ * @return The amount of messages, -1 if the queue cannot be inspected: in-process queues are only known to the process owning them.
+ */
+int get_message_queue_depth(int mq_id){
+    struct msqid_ds status;
+
+    if ( mq_id < 0 || msgctl(mq_id, IPC_STAT, &status) == -1 ){
+        return -1;
+    }
+    return (int)status.msg_qnum;
+}
+
 /**
  * Destroy a given message queue.
  *
  * @param mq_id An integer number representing he ID of the message queue.
  */
 void close_message_queue(int mq_id){
+    mailbox_t* mailbox;
+
+    if ( mq_id < 0 ){
+        /* This is an in-process message queue, no thread must be using it anymore. */
+        mailbox = get_local_message_queue(mq_id);
+        local_message_queues[-mq_id - 1] = NULL;
+        pthread_mutex_destroy(&mailbox->mutex);
+        pthread_cond_destroy(&mailbox->not_empty);
+        free(mailbox->messages);
+        free(mailbox);
+        return;
+    }
     /* Destroy the message queue. */
     if ( msgctl(mq_id, IPC_RMID, NULL) == -1 ){
         printf("Cannot close the message queue, aborting.\n");
@@ -78,3 +449,142 @@ void close_message_queue(int mq_id){
         exit(5);
     }
 }
+
+/**
+ * Initializes a message ring, it must be called before any process starts using it.
+ *
+ * @param ring The reference to the ring to initialize.
+ */
+void init_message_ring(message_ring_t* ring){
+    unsigned int i;
+
+    ring->head = ring->tail = 0;
+    ring->consumer_sleeping = ring->waiting_producers = ring->space_generation = 0;
+    /* Each slot is writable when its sequence number matches the producer cursor. */
+    for ( i = 0 ; i < MESSAGE_RING_CAPACITY ; i++ ){
+        ring->slots[i].sequence = i;
+    }
+}
+
+/**
+ * Pushes a given message into the given ring, if the ring is full the caller will sleep until the consumer makes room.
+ *
+ * @param ring The reference to the ring the message will be pushed into.
+ * @param msg The reference to the message to send.
+ */
+void ring_send_message(message_ring_t* ring, message_t* msg){
+    unsigned int position, sequence, generation;
+    message_slot_t* slot;
+    int difference;
+
+    position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    while (1){
+        slot = &ring->slots[position & ( MESSAGE_RING_CAPACITY - 1 )];
+        sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        difference = (int)( sequence - position );
+        if ( difference == 0 ){
+            /* The slot is free, try to reserve it. */
+            if ( __atomic_compare_exchange_n(&ring->tail, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ){
+                break;
+            }
+        }else if ( difference < 0 ){
+            /* The ring is full, wait for the consumer to pop some message. */
+            generation = __atomic_load_n(&ring->space_generation, __ATOMIC_ACQUIRE);
+            __atomic_add_fetch(&ring->waiting_producers, 1, __ATOMIC_SEQ_CST);
+            sequence = __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST);
+            if ( (int)( sequence - position ) < 0 ){
+                wait_on_word(&ring->space_generation, generation, NULL);
+            }
+            __atomic_sub_fetch(&ring->waiting_producers, 1, __ATOMIC_SEQ_CST);
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }else{
+            /* Another producer took this slot, try again with the updated cursor. */
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+    /* Copy the message and publish the slot to the consumer. */
+    memcpy(&slot->message, msg, sizeof(message_t));
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    /* Wake the consumer up only if it went to sleep, this keeps the fast path free of system calls. */
+    if ( __atomic_load_n(&ring->consumer_sleeping, __ATOMIC_RELAXED) == 1 && __atomic_exchange_n(&ring->consumer_sleeping, 0, __ATOMIC_SEQ_CST) == 1 ){
+        wake_on_word(&ring->consumer_sleeping, 1);
+    }
+}
+
+/**
+ * Pops a message from the given ring, if the ring is empty the caller will sleep until a message is pushed.
+ * Only one process at a time can consume messages from a ring.
+ *
+ * @param ring The reference to the ring.
+ *
+ * @return The message extracted.
+ */
+message_t ring_receive_message(message_ring_t* ring){
+    unsigned int position;
+    message_slot_t* slot;
+    message_t msg;
+
+    position = ring->head;
+    slot = &ring->slots[position & ( MESSAGE_RING_CAPACITY - 1 )];
+    while ( __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != position + 1 ){
+        /* Announce we are going to sleep, then check again as a producer may have published in the meantime. */
+        __atomic_store_n(&ring->consumer_sleeping, 1, __ATOMIC_SEQ_CST);
+        if ( __atomic_load_n(&slot->sequence, __ATOMIC_SEQ_CST) != position + 1 ){
+            wait_on_word(&ring->consumer_sleeping, 1, NULL);
+        }
+        __atomic_store_n(&ring->consumer_sleeping, 0, __ATOMIC_RELAXED);
+    }
+    memcpy(&msg, &slot->message, sizeof(message_t));
+    /* Hand the slot back to the producers for the next lap. */
+    __atomic_store_n(&slot->sequence, position + MESSAGE_RING_CAPACITY, __ATOMIC_RELEASE);
+    ring->head = position + 1;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&ring->waiting_producers, __ATOMIC_RELAXED) > 0 ){
+        __atomic_add_fetch(&ring->space_generation, 1, __ATOMIC_SEQ_CST);
+        wake_on_word(&ring->space_generation, 0x7fffffff);
+    }
+    return msg;
+}
+
+/**
+ * Returns the amount of messages pushed into the given ring and not yet popped, it can be read by any process.
+ *
+ * @param ring The reference to the ring.
+ *
+ * @return The amount of messages.
+ */
+unsigned int get_message_ring_depth(message_ring_t* ring){
+    unsigned int head;
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head;
+}
+
+/**
+ * Sends a given message to the master process using the transport the game board has been configured with.
+ *
+ * @param game_board The reference to the game board.
+ * @param msg The reference to the message to send.
+ */
+void send_message_to_coordinator(board_t* game_board, message_t* msg){
+    if ( game_board->transport == TRANSPORT_MESSAGE_RING ){
+        ring_send_message(&game_board->coordinator_ring, msg);
+    }else{
+        send_message(game_board->coordinator_mq_id, msg);
+    }
+}
+
+/**
+ * Pops a message sent to the master process using the transport the game board has been configured with.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @return The message extracted.
+ */
+message_t receive_coordinator_message(board_t* game_board){
+    if ( game_board->transport == TRANSPORT_MESSAGE_RING ){
+        return ring_receive_message(&game_board->coordinator_ring);
+    }
+    return receive_message(game_board->coordinator_mq_id);
+}
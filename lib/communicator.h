@@ -1,13 +1,33 @@
 #ifndef PROCHESS_COMMUNICATOR_H
 #define PROCHESS_COMMUNICATOR_H
 
+#include <time.h>
 #include <sys/types.h>
 
 #include "types.h"
 
+boolean wait_for_control_event(board_t* game_board, unsigned int generation, long timeout);
+void wait_on_word(unsigned int* address, unsigned int expected, struct timespec* timeout);
+void watch_message_queue(int mq_id, void (*on_message)(void*), void* argument);
+void send_message_to_coordinator(board_t* game_board, message_t* msg);
+void ring_send_message(message_ring_t* ring, message_t* msg);
+message_t receive_coordinator_message(board_t* game_board);
+unsigned int get_message_ring_depth(message_ring_t* ring);
+message_t ring_receive_message(message_ring_t* ring);
+void wake_on_word(unsigned int* address, int count);
+boolean poll_message(int mq_id, message_t* msg);
+void init_message_ring(message_ring_t* ring);
 void send_message(int mq_id, message_t* msg);
+void record_round_start(board_t* game_board);
+int open_message_queue(board_t* game_board);
+unsigned long get_monotonic_nanoseconds();
+void release_round(board_t* game_board);
+int get_message_queue_depth(int mq_id);
+void close_round(board_t* game_board);
 message_t receive_message(int mq_id);
+void wake_pawns(board_t* game_board);
 void close_message_queue(int mq_id);
+int generate_local_message_queue();
 int generate_message_queue();
 
 #endif
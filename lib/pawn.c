@@ -3,75 +3,99 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/wait.h>
 
 #include "board.h"
 #include "communicator.h"
+#include "recorder.h"
+#include "scheduler.h"
+#include "random.h"
+#include "telemetry.h"
+#include "thread.h"
+#include "tracer.h"
 #include "types.h"
 
 /**
- * Returns the position where a pawn should be moved to.
+ * The stack size of the threads running a pawn, pawns only need a few local variables.
+ */
+#define PAWN_STACK_SIZE 65536
+
+/**
+ * Returns the amount of moves needed to go from a given cell to the target of a pawn.
+ *
+ * @param game_board The reference to the game board.
+ * @param index The index of the cell to start from.
+ * @param target The target of the pawn, either the index of a cell or PAWN_TARGET_NEAREST.
+ * @param distances The reference to the distance map, it is used when heading to the nearest flag.
+ *
+ * @return The amount of moves, DISTANCE_UNREACHABLE if no flag is left to head to.
+ *
+ * @private
+ */
+unsigned int measure_distance(board_t* game_board, unsigned int index, unsigned int target, unsigned int* distances){
+    if ( target == PAWN_TARGET_NEAREST ){
+        return __atomic_load_n(&distances[index], __ATOMIC_RELAXED);
+    }
+    /* Pawns are not obstacles as they keep moving, so the distance to the target is the manhattan one. */
+    return compute_distance(game_board, index, target);
+}
+
+/**
+ * Returns the position where a pawn should be moved to: one step closer to its target, or to the nearest uncaptured flag according
+ * to the distance map, picking at random among the free cells that are equally close, or a random step if none of them is free.
+ * Sparse boards have no distance map, pawns looking for the nearest flag head to the one closest to them instead.
  *
  * @param game_board The reference to the game board.
  * @param current_position The reference to the current position of the pawn to move.
+ * @param target The target of the pawn, either the index of a cell or PAWN_TARGET_NEAREST.
+ * @param generator The reference to the random number generator of the pawn.
  *
  * @return The suggested position.
  *
  * @private
  */
-coords_t get_next_position(board_t* game_board, coords_t* current_position){
-    coords_t position;
-    int orientation;
-    boolean valid;
-
-    do{
-        valid = 1;
-        /* Pick a random direction. */
-        orientation = (int)lrand48() % 5;
-        switch ( orientation ){
-            case 1: {
-                if ( current_position->y == 0 ){
-                    /* Position would be out of the board (top). */
-                    valid = 0;
-                }else{
-                    position.x = current_position->x;
-                    position.y = current_position->y - 1;
-                }
-            }break;
-            case 2: {
-                if ( current_position->x == game_board->width ){
-                    /* Position would be out of the board (right). */
-                    valid = 0;
-                }else{
-                    position.x = current_position->x + 1;
-                    position.y = current_position->y;
-                }
-            }break;
-            case 3: {
-                if ( current_position->y == game_board->height ){
-                    /* Position would be out of the board (bottom). */
-                    valid = 0;
-                }else{
-                    position.x = current_position->x;
-                    position.y = current_position->y + 1;
-                }
-            }break;
-            case 4: {
-                if ( current_position->x == 0 ){
-                    /* Position would be out of the board (left). */
-                    valid = 0;
-                }else{
-                    position.x = current_position->x - 1;
-                    position.y = current_position->y;
-                }
-            }break;
-            default: {
-                valid = 0;
-            }break;
+coords_t get_next_position(board_t* game_board, coords_t* current_position, unsigned int target, random_t* generator){
+    unsigned int i, count, candidates, distance, neighbour, next_neighbour, sequence, *distances;
+    neighbours_t neighbours;
+    coords_t next_position;
+
+    count = get_cell_neighbours(game_board, current_position->index, &neighbours);
+    distances = get_distance_map(game_board, &sequence);
+    if ( distances == NULL && target == PAWN_TARGET_NEAREST && find_nearest_flag(game_board, current_position->index, &target) == 0 ){
+        /* No distance map and no flag left, step aside in a random direction. */
+        compute_coords(game_board, neighbours.cells[random_below(generator, count)], &next_position);
+        return next_position;
+    }
+    while ( 1 ){
+        distance = measure_distance(game_board, current_position->index, target, distances);
+        candidates = next_neighbour = 0;
+        for ( i = 0 ; i < count ; i++ ){
+            neighbour = neighbours.cells[i];
+            if ( measure_distance(game_board, neighbour, target, distances) >= distance ){
+                continue;
+            }
+            /* Cells held by another pawn would make the move fail. */
+            if ( CELL_OCCUPANT_TYPE(load_cell(game_board, neighbour)) == 2 ){
+                continue;
+            }
+            /* Keep each candidate with equal probability without having to store them all. */
+            candidates++;
+            if ( random_below(generator, candidates) == 0 ){
+                next_neighbour = neighbour;
+            }
         }
-    }while( valid == 0 );
-    /* Set the 1D based index corresponding to the generated position. */
-    position.index = compute_index(game_board, &position);
-    return position;
+        if ( is_distance_map_current(game_board, distances, sequence) == 1 ){
+            break;
+        }
+        /* The map has been rewritten while it was read, read the one just published. */
+        distances = get_distance_map(game_board, &sequence);
+    }
+    if ( candidates == 0 ){
+        /* No flag left or the way is blocked, step aside in a random direction, only the ones within the board are listed. */
+        next_neighbour = neighbours.cells[random_below(generator, count)];
+    }
+    compute_coords(game_board, next_neighbour, &next_position);
+    return next_position;
 }
 
 /**
@@ -85,14 +109,19 @@ coords_t get_next_position(board_t* game_board, coords_t* current_position){
 void signal_achievement(board_t* game_board, char player_pseudo_name){
     message_t message;
 
+    if ( game_board->execution_mode == EXECUTION_MODE_SIMULATION ){
+        /* The simulator reads captures from the flag index. */
+        return;
+    }
+    record_histogram_value(&game_board->telemetry.capture_time, get_monotonic_nanoseconds() - __atomic_load_n(&game_board->round_release_time, __ATOMIC_RELAXED));
     /* Create the message. */
     message.message_type = 9;
     message.player_pseudo_name = player_pseudo_name;
-    send_message(game_board->coordinator_mq_id, &message);
+    send_message_to_coordinator(game_board, &message);
 }
 
 /**
- * Informs the master process that the pawn has moved.
+ * Accounts the move the pawn has just done in the moves counter its player owns in the game board.
  *
  * @param game_board The reference to the game board.
  * @param player_pseudo_name The pawn owner player's pseudo name.
@@ -100,15 +129,370 @@ void signal_achievement(board_t* game_board, char player_pseudo_name){
  * @private
  */
 void notify_movement(board_t* game_board, char player_pseudo_name){
+    if ( __atomic_load_n(&game_board->round_in_progress, __ATOMIC_RELAXED) == 1 ){
+        /* Players are named after capital letters, so the pseudo name gives the counter to increment. */
+        __atomic_add_fetch(&game_board->used_moves[player_pseudo_name - 65], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Counts the move the pawn has just done in its slot, only the pawn writes it so no other pawn ever waits for the counters.
+ *
+ * @param context The reference to the pawn.
+ * @param result The outcome of the move (MOVE_DONE, MOVE_CAPTURED or MOVE_BLOCKED).
+ *
+ * @private
+ */
+void count_pawn_move(pawn_context_t* context, unsigned short result){
+    pawn_slot_t* slot;
+
+    slot = &get_pawn_slots(context->game_board)[context->slot];
+    __atomic_store_n(&slot->moves, slot->moves + 1, __ATOMIC_RELAXED);
+    if ( result == MOVE_BLOCKED ){
+        __atomic_store_n(&slot->blocked_moves, slot->blocked_moves + 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Publishes the position of the pawn in its slot, so that its player can plan the next round.
+ *
+ * @param context The reference to the pawn.
+ *
+ * @private
+ */
+void publish_position(pawn_context_t* context){
+    __atomic_store_n(&get_pawn_slots(context->game_board)[context->slot].position, context->position.index, __ATOMIC_RELAXED);
+}
+
+/**
+ * Records an event about the pawn in the event log, positions are recorded as "y * width + x".
+ *
+ * @param context The reference to the pawn.
+ * @param type The type of the event (EVENT_PLACEMENT, EVENT_MOVE or EVENT_CAPTURE).
+ * @param from The position the pawn is leaving, ignored unless the pawn is moving.
+ *
+ * @private
+ */
+void record_pawn_event(pawn_context_t* context, unsigned char type, coords_t* from){
+    unsigned int width;
+
+    width = context->game_board->width;
+    record_event(type, context->player_pseudo_name, context->slot, from->y * width + from->x, context->position.y * width + context->position.x, 0);
+}
+
+/**
+ * Picks a random free cell and places the pawn there.
+ *
+ * @param context The reference to the pawn.
+ *
+ * @private
+ */
+void enter_board(pawn_context_t* context){
+    unsigned long trace_start;
+
+    TRACE_BEGIN(trace_start);
+    context->available_moves = context->max_moves;
+    context->playing = context->terminated = 0;
+    context->hold_end = 0;
+    if ( context->assigned_position == 1 && place_pawn(context->game_board, &context->position, context->player_pseudo_name, context->slot) != MOVE_BLOCKED ){
+        /* The position drawn for this pawn by the master process was still free. */
+        publish_position(context);
+        record_pawn_event(context, EVENT_PLACEMENT, &context->position);
+        TRACE_END(TRACE_SPAN_PLACEMENT, TRACE_TRACK_PAWN(context->slot), trace_start);
+        return;
+    }
+    do {
+        /* Pick a random free position where the pawn will be placed to. */
+        if ( take_free_position(context->game_board, &context->position, &context->generator) == 0 ){
+            printf("Cannot place the pawn as the game board is full, aborting.\n");
+            exit(6);
+        }
+        /* Place the pawn on the game board according tot he generated random position, another pawn may have taken it meanwhile. */
+    } while ( place_pawn(context->game_board, &context->position, context->player_pseudo_name, context->slot) == MOVE_BLOCKED );
+    publish_position(context);
+    record_pawn_event(context, EVENT_PLACEMENT, &context->position);
+    TRACE_END(TRACE_SPAN_PLACEMENT, TRACE_TRACK_PAWN(context->slot), trace_start);
+}
+
+/**
+ * Updates the pawn state according to a message received from its player.
+ *
+ * @param context The reference to the pawn.
+ * @param message The reference to the message received.
+ *
+ * @private
+ */
+void handle_pawn_message(pawn_context_t* context, message_t* message){
+    switch ( message->message_type ){
+        case 11: {
+            context->terminated = 1;
+        }break;
+        case 12: {
+            context->available_moves = context->max_moves;
+        }break;
+    }
+}
+
+/**
+ * Checks if a new round has been released since the pawn last looked at the game board, if so the pawn starts playing.
+ *
+ * @param context The reference to the pawn.
+ *
+ * @return If the pawn has joined a new round will be returned "1", otherwise "0".
+ *
+ * @private
+ */
+boolean join_round(pawn_context_t* context){
+    unsigned int generation;
+
+    generation = __atomic_load_n(&context->game_board->control_generation, __ATOMIC_ACQUIRE);
+    if ( generation == context->control_generation ){
+        return 0;
+    }
+    context->control_generation = generation;
+    context->capture_generation = __atomic_load_n(&context->game_board->capture_generation, __ATOMIC_ACQUIRE);
+    /* The generation also changes when pawns are woken up to check their messages. */
+    if ( __atomic_load_n(&context->game_board->round_in_progress, __ATOMIC_ACQUIRE) != 1 ){
+        return 0;
+    }
+    /* Written by the player before it got ready, so it is visible once the round has been released. */
+    context->target = get_pawn_slots(context->game_board)[context->slot].target;
+    if ( context->target == PAWN_TARGET_NONE ){
+        /* No flag has been assigned to the pawn, it holds its position until the next round. */
+        return 0;
+    }
+    context->playing = 1;
+    record_round_start(context->game_board);
+    return 1;
+}
+
+/**
+ * Moves the pawn once, the pawn stops playing when it runs out of moves, captures a flag or the round ends.
+ *
+ * @param context The reference to the pawn.
+ *
+ * @return If the pawn has tried to move then "1" will be returned, "0" if it stopped without moving.
+ *
+ * @private
+ */
+boolean play_move(pawn_context_t* context){
+    unsigned long trace_start, move_start, claim_start, claim_end;
+    coords_t next_position, previous_position;
+    unsigned int capture_generation;
+    unsigned short result;
+    board_t* game_board;
+
+    game_board = context->game_board;
+    capture_generation = __atomic_load_n(&game_board->capture_generation, __ATOMIC_ACQUIRE);
+    if ( capture_generation != context->capture_generation ){
+        /* A flag has been captured since the last move, there is no point in moving once none is left. */
+        context->capture_generation = capture_generation;
+        if ( all_flags_captured(game_board) == 1 ){
+            context->playing = 0;
+            return 0;
+        }
+        if ( context->target != PAWN_TARGET_NEAREST && CELL_OCCUPANT_TYPE(load_cell(game_board, context->target)) != 1 ){
+            /* Another pawn got to the flag first, head to the nearest one left. */
+            context->target = PAWN_TARGET_NEAREST;
+        }
+    }
+    /* Any control event stops the pawn: it handles its messages and then joins the next round from scratch. */
+    if ( context->available_moves == 0 || __atomic_load_n(&game_board->control_generation, __ATOMIC_ACQUIRE) != context->control_generation ){
+        context->playing = 0;
+        return 0;
+    }
+    /* Get the position where the pawn should be moved to. */
+    TELEMETRY_CLOCK(move_start);
+    next_position = get_next_position(game_board, &context->position, context->target, &context->generator);
+    /* Move the pawn and check if a flag is present in its new position. */
+    TRACE_BEGIN(trace_start);
+    TELEMETRY_CLOCK(claim_start);
+    result = move_pawn(game_board, &context->position, &next_position, context->player_pseudo_name, context->slot);
+    TELEMETRY_CLOCK(claim_end);
+    TRACE_END(TRACE_SPAN_MOVE, TRACE_TRACK_PAWN(context->slot), trace_start);
+    TELEMETRY_RECORD(game_board->telemetry.move_latency, move_start, claim_end);
+    TELEMETRY_RECORD(game_board->telemetry.claim_time, claim_start, claim_end);
+    count_pawn_move(context, result);
+    if ( result != MOVE_BLOCKED ){
+        previous_position = context->position;
+        context->position = next_position;
+        publish_position(context);
+        record_pawn_event(context, EVENT_MOVE, &previous_position);
+    }
+    context->available_moves--;
+    /* Account the move in the player's counter. */
+    notify_movement(game_board, context->player_pseudo_name);
+    if ( result == MOVE_CAPTURED ){
+        context->available_moves = 0;
+        record_pawn_event(context, EVENT_CAPTURE, &context->position);
+        /* Signal the master process a flag has been captured. */
+        signal_achievement(game_board, context->player_pseudo_name);
+    }
+    if ( context->available_moves == 0 ){
+        context->playing = 0;
+    }
+    return 1;
+}
+
+/**
+ * Places the pawn and then plays according to the messages received from its player, it returns once the pawn has been terminated.
+ *
+ * @param context The reference to the information the pawn needs to play.
+ *
+ * @private
+ */
+void run_pawn(pawn_context_t* context){
+    unsigned long trace_start;
+    unsigned int generation;
+    message_t message;
+
+    enter_board(context);
+    while ( context->terminated == 0 ){
+        /* Taken before polling, a message sent meanwhile comes along with a new generation and the pawn won't sleep. */
+        generation = __atomic_load_n(&context->game_board->control_generation, __ATOMIC_ACQUIRE);
+        /* Handle the messages sent by the player, they reset the moves or terminate the pawn. */
+        while ( context->terminated == 0 && poll_message(context->mq_id, &message) == 1 ){
+            handle_pawn_message(context, &message);
+        }
+        if ( context->terminated == 0 && join_round(context) == 0 ){
+            /* Sleep until a round is released or the player wakes its pawns up. */
+            TRACE_BEGIN(trace_start);
+            wait_for_control_event(context->game_board, generation, -1);
+            TRACE_END(TRACE_SPAN_WAIT, TRACE_TRACK_PAWN(context->slot), trace_start);
+        }
+        while ( context->playing == 1 ){
+            play_move(context);
+            /* Hold the new position for a while before moving again, unless a control event happens meanwhile. */
+            TRACE_BEGIN(trace_start);
+            hold_position(context->game_board, context->control_generation);
+            TRACE_END(TRACE_SPAN_HOLD, TRACE_TRACK_PAWN(context->slot), trace_start);
+        }
+    }
+}
+
+/**
+ * Entry point of the threads running a pawn.
+ *
+ * @param argument The reference to the pawn context, it will be released once the pawn has been terminated.
+ *
+ * @return Nothing.
+ *
+ * @private
+ */
+void* pawn_thread(void* argument){
+    run_pawn((pawn_context_t*)argument);
+    free(argument);
+    return NULL;
+}
+
+/**
+ * Runs a pawn step by step as a scheduler task: it handles the pending messages and then does at most one move.
+ *
+ * @param argument The reference to the pawn context.
+ *
+ * @return The nanoseconds the pawn must hold its position for, 0 if it stopped on a control event, or TASK_PARK if it has
+ * nothing to do, or TASK_DONE once terminated.
+ *
+ * @private
+ */
+long pawn_task(void* argument){
+    pawn_context_t* context;
     message_t message;
+    unsigned long now;
+
+    context = (pawn_context_t*)argument;
+    while ( poll_message(context->mq_id, &message) == 1 ){
+        handle_pawn_message(context, &message);
+        if ( context->terminated == 1 ){
+            return TASK_DONE;
+        }
+    }
+    if ( context->playing == 0 ){
+        if ( join_round(context) == 0 ){
+            return TASK_PARK;
+        }
+    }else{
+        /* A message may cut the hold short, the pawn only moves early if a control event happened meanwhile. */
+        now = get_monotonic_nanoseconds();
+        if ( now < context->hold_end && __atomic_load_n(&context->game_board->control_generation, __ATOMIC_ACQUIRE) == context->control_generation ){
+            return (long)( context->hold_end - now );
+        }
+    }
+    if ( play_move(context) == 0 ){
+        /* Stopped on a control event, run again right away to handle it instead of holding first. */
+        return 0;
+    }
+    /* The hold time becomes a timer instead of a blocking sleep. */
+    context->hold_end = get_monotonic_nanoseconds() + (unsigned long)context->game_board->waiting_time;
+    return context->game_board->waiting_time;
+}
+
+/**
+ * Submits a pawn task to the scheduler whenever a message is sent to the pawn.
+ *
+ * @param argument The reference to the pawn context.
+ *
+ * @private
+ */
+void wake_pawn_task(void* argument){
+    pawn_context_t* context;
+
+    context = (pawn_context_t*)argument;
+    submit_task(context->game_board->scheduler, &context->task);
+}
 
-    if ( game_board->round_in_progress == 1 ){
-        /* Create the message. */
-        message.message_type = 10;
-        message.player_pseudo_name = player_pseudo_name;
-        send_message(game_board->coordinator_mq_id, &message);
+/**
+ * Prepares a pawn driven step by step by the simulator instead of running on its own, the pawn is placed right away.
+ *
+ * @param context The reference to the pawn to prepare.
+ * @param game_board The reference to the game board.
+ * @param player_pseudo_name The pseudo name associated to the player the pawn belongs to.
+ * @param max_moves The maximum number of moves a pawn can do during a round.
+ * @param position The position the pawn should be placed at, if NULL a random free position will be picked.
+ * @param slot The number of the pawn in placement order (pawn number * player count + player number), it also gives the random stream of the pawn.
+ */
+void init_simulated_pawn(pawn_context_t* context, board_t* game_board, char player_pseudo_name, unsigned int max_moves, coords_t* position, unsigned int slot){
+    context->game_board = game_board;
+    context->mq_id = -1;
+    context->player_pseudo_name = player_pseudo_name;
+    context->max_moves = max_moves;
+    /* Stream zero belongs to the master process. */
+    seed_random(&context->generator, game_board->random_seed, slot + 1);
+    context->slot = slot;
+    context->target = PAWN_TARGET_NEAREST;
+    context->assigned_position = position != NULL ? 1 : 0;
+    if ( position != NULL ){
+        context->position = *position;
     }
+    context->control_generation = game_board->control_generation;
+    enter_board(context);
+}
 
+/**
+ * Makes a simulated pawn join the round that has just started with all its moves available.
+ *
+ * @param context The reference to the pawn.
+ */
+void start_simulated_round(pawn_context_t* context){
+    context->available_moves = context->max_moves;
+    context->control_generation = context->game_board->control_generation;
+    context->capture_generation = context->game_board->capture_generation;
+    context->target = get_pawn_slots(context->game_board)[context->slot].target;
+    context->playing = context->target != PAWN_TARGET_NONE ? 1 : 0;
+}
+
+/**
+ * Makes a simulated pawn do a single move, if it is still playing.
+ *
+ * @param context The reference to the pawn.
+ *
+ * @return If the pawn is still playing after the move will be returned "1", otherwise "0".
+ */
+boolean step_simulated_pawn(pawn_context_t* context){
+    if ( context->playing == 1 ){
+        play_move(context);
+    }
+    return context->playing;
 }
 
 /**
@@ -116,74 +500,116 @@ void notify_movement(board_t* game_board, char player_pseudo_name){
  *
  * @param game_board The reference to the game board.
  * @param player_pseudo_name The pseudo name associated to the player pawn will belong to.
- * @param game_board_shm_id The ID of the shared memory segment where the game board has been allocated at.
  * @param max_moves The maximum number of moves a pawn can do during a round.
+ * @param position The position the pawn should be placed at, if NULL a random free position will be picked.
+ * @param slot The number of the pawn in placement order (pawn number * player count + player number), it also gives the random stream of the pawn.
  *
  * @return A structure representing the pawn spawned.
  */
-pawn_t spawn_pawn(board_t* game_board, char player_pseudo_name, int game_board_shm_id, unsigned int max_moves){
+pawn_t spawn_pawn(board_t* game_board, char player_pseudo_name, unsigned int max_moves, coords_t* position, unsigned int slot){
+    pawn_context_t* context;
     pid_t pawn_pid;
-    int pawn_mq_id;
     pawn_t pawn;
 
+    context = (pawn_context_t*)malloc(sizeof(pawn_context_t));
+    if ( context == NULL ){
+        printf("Cannot allocate the pawn, aborting.\n");
+        exit(5);
+    }
+    context->game_board = game_board;
+    context->player_pseudo_name = player_pseudo_name;
+    context->max_moves = max_moves;
+    /* Stream zero belongs to the master process. */
+    seed_random(&context->generator, game_board->random_seed, slot + 1);
+    context->slot = slot;
+    context->target = PAWN_TARGET_NEAREST;
+    context->assigned_position = position != NULL ? 1 : 0;
+    /* Read before the pawn starts so that a round released while it is being placed is not missed. */
+    context->control_generation = __atomic_load_n(&game_board->control_generation, __ATOMIC_ACQUIRE);
+    if ( position != NULL ){
+        context->position = *position;
+        /* Known right away, the pawn process may not have placed itself yet when its player plans the first round. */
+        __atomic_store_n(&get_pawn_slots(game_board)[slot].position, position->index, __ATOMIC_RELAXED);
+    }
     /* Allocate a new message queue for the pawn that is going to be generated. */
-    pawn_mq_id = generate_message_queue();
+    context->mq_id = open_message_queue(game_board);
+    pawn.mq_id = context->mq_id;
+    get_pawn_slots(game_board)[slot].mq_id = context->mq_id;
+    pawn.context = NULL;
+    if ( game_board->execution_mode == EXECUTION_MODE_TASK ){
+        /* Place the pawn right away, the task will run whenever the player sends it a message. */
+        pawn.pid = getpid();
+        pawn.context = context;
+        enter_board(context);
+        init_task(game_board->scheduler, &context->task, pawn_task, context);
+        watch_message_queue(context->mq_id, wake_pawn_task, context);
+        return pawn;
+    }else if ( game_board->execution_mode == EXECUTION_MODE_THREAD ){
+        /* Run the pawn as a thread sharing the game board with current process. */
+        pawn.pid = getpid();
+        pawn.thread = start_thread(pawn_thread, context, PAWN_STACK_SIZE);
+        return pawn;
+    }
+    /* Flush pending output so that it won't be duplicated by the child process. */
+    fflush(stdout);
     pawn_pid = fork();
     if ( pawn_pid == -1 ){
         printf("Cannot fork process, aborting.\n");
         exit(5);
     }else if ( pawn_pid == 0 ){
-        unsigned int available_moves;
-        boolean has_conquered_flag;
-        board_t* local_game_board;
-        coords_t next_position;
-        message_t message;
-        coords_t position;
-
-        available_moves = max_moves;
-        /* Attach the game board to current process memory. */
-        local_game_board = get_board(game_board_shm_id);
-        /* Pick a random position where the pawn will be placed to. */
-        position = get_random_position(game_board, 0);
-        /* Place the pawn on the game board according tot he generated random position. */
-        place_pawn(local_game_board, &position, player_pseudo_name);
-        while(1){
-            message = receive_message(pawn_mq_id);
-            switch ( message.message_type ){
-                case 8: {
-                    while ( available_moves > 0 ){
-                        if ( game_board->round_in_progress != 1 ){
-                            break;
-                        }
-                        /* Get the position where the pawn should be moved to. */
-                        next_position = get_next_position(local_game_board, &position);
-                        /* Move the pawn and check if a flag is present in its new position. */
-                        has_conquered_flag = move_pawn(local_game_board, &position, &next_position, player_pseudo_name);
-                        position = next_position;
-                        available_moves--;
-                        /* Inform the master process the pawn has moved. */
-                        notify_movement(local_game_board, player_pseudo_name);
-                        if ( has_conquered_flag == 1 ){
-                            available_moves = 0;
-                            /* Signal the master process a flag has been captured. */
-                            signal_achievement(local_game_board, player_pseudo_name);
-                        }
-                    }
-                }break;
-                case 11: {
-                    exit(0);
-                }
-                case 12: {
-                    available_moves = max_moves;
-                }break;
-            }
+        /* The game board segment is inherited from the player process, the event log is not. */
+        fork_event_log();
+        run_pawn(context);
+        exit(0);
+    }
+    /* Setup pawn's information. */
+    free(context);
+    pawn.pid = pawn_pid;
+    return pawn;
+}
+
+/**
+ * Waits for the given pawns to terminate, it must be called after they have been signaled to do so.
+ *
+ * @param game_board The reference to the game board.
+ * @param pawn_list A reference to the list of all the pawns to wait for.
+ * @param pawn_count The amount of pawns in the given list.
+ */
+void wait_for_pawns(board_t* game_board, pawn_t* pawn_list, unsigned int pawn_count){
+    unsigned int i;
+
+    if ( game_board->execution_mode == EXECUTION_MODE_THREAD ){
+        for ( i = 0 ; i < pawn_count ; i++ ){
+            join_thread(pawn_list[i].thread);
+        }
+    }else if ( game_board->execution_mode == EXECUTION_MODE_TASK ){
+        for ( i = 0 ; i < pawn_count ; i++ ){
+            wait_for_task(game_board->scheduler, &pawn_list[i].context->task);
+            free(pawn_list[i].context);
         }
     }else{
-        /* Setup pawn's information. */
-        pawn.mq_id = pawn_mq_id;
-        pawn.pid = pawn_pid;
+        /* Pawn processes must be reaped before their message queues go away, or they would miss the message terminating them. */
+        for ( i = 0 ; i < pawn_count ; i++ ){
+            waitpid(pawn_list[i].pid, NULL, 0);
+        }
+    }
+}
+
+/**
+ * Resumes the given pawns after a round has been released, only pawns running as tasks need it as the others wait on the game board.
+ *
+ * @param game_board The reference to the game board.
+ * @param pawn_list A reference to the list of all the pawns to resume.
+ * @param pawn_count The amount of pawns in the given list.
+ */
+void resume_pawns(board_t* game_board, pawn_t* pawn_list, unsigned int pawn_count){
+    unsigned int i;
+
+    if ( game_board->execution_mode == EXECUTION_MODE_TASK ){
+        for ( i = 0 ; i < pawn_count ; i++ ){
+            submit_task(game_board->scheduler, &pawn_list[i].context->task);
+        }
     }
-    return pawn;
 }
 
 /**
@@ -3,8 +3,13 @@
 
 #include "types.h"
 
-pawn_t spawn_pawn(board_t* game_board, char player_pseudo_name, int game_board_shm_id, unsigned int max_moves);
+void init_simulated_pawn(pawn_context_t* context, board_t* game_board, char player_pseudo_name, unsigned int max_moves, coords_t* position, unsigned int slot);
+pawn_t spawn_pawn(board_t* game_board, char player_pseudo_name, unsigned int max_moves, coords_t* position, unsigned int slot);
 void broadcast_message_to_pawns(pawn_t* pawn_list, unsigned int pawn_count, message_t* message);
 void broadcast_signal_to_pawns(pawn_t* pawn_list, unsigned int pawn_count, unsigned short type);
+void wait_for_pawns(board_t* game_board, pawn_t* pawn_list, unsigned int pawn_count);
+void resume_pawns(board_t* game_board, pawn_t* pawn_list, unsigned int pawn_count);
+boolean step_simulated_pawn(pawn_context_t* context);
+void start_simulated_round(pawn_context_t* context);
 
 #endif
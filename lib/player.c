@@ -5,12 +5,22 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
+#include <sys/wait.h>
 
 #include "board.h"
 #include "pawn.h"
 #include "communicator.h"
+#include "recorder.h"
+#include "thread.h"
+#include "tracer.h"
 #include "types.h"
 
+/**
+ * The stack size of the threads running a player, it must fit the list of the pawns the player owns.
+ */
+#define PLAYER_STACK_SIZE 1048576
+
 /**
  * Sends a simple numeric signal to the master process.
  *
@@ -26,7 +36,7 @@ void send_signal_message_to_master(board_t* game_board, unsigned short type){
     message.message_type = type;
     message.player_pseudo_name = 0;
     /* Send the message to the master process's message queue. */
-    send_message(game_board->coordinator_mq_id, &message);
+    send_message_to_coordinator(game_board, &message);
 }
 
 /**
@@ -69,16 +79,21 @@ void organization_completed(board_t* game_board){
 /**
  * Informs all the pawns contained in the given list that they must end their processes.
  *
+ * @param game_board The reference to the game board.
  * @param pawn_list The reference to the list of all the pawns owned by a player.
  * @param pawn_count An integer number representing he amount of generated pawns.
  *
  * @private
  */
-void destroy_pawns(pawn_t* pawn_list, unsigned int pawn_count){
+void destroy_pawns(board_t* game_board, pawn_t* pawn_list, unsigned int pawn_count){
     unsigned int i;
 
     /* Send the message in order to inform about the end of their processes. */
     broadcast_signal_to_pawns(pawn_list, pawn_count, 11);
+    /* Pawns waiting for a round must check their messages. */
+    wake_pawns(game_board);
+    /* Pawns must be gone before their message queues are released. */
+    wait_for_pawns(game_board, pawn_list, pawn_count);
     /* Deallocate the message queue assigned to the pawns. */
     for ( i = 0 ; i < pawn_count ; i++ ){
         close_message_queue(pawn_list[i].mq_id);
@@ -101,87 +116,258 @@ void allow_pawn_placing(player_t* player){
 }
 
 /**
- * Generates the player processes.
+ * Places the player's pawns and then forwards the messages received from the master process to them, it returns once the player has been terminated.
+ *
+ * @param context The reference to the information the player needs to play.
+ *
+ * @private
+ */
+void run_player(player_context_t* context){
+    pawn_t pawn_list[context->pawn_count];
+    unsigned long trace_start;
+    board_t* game_board;
+    int remaining_pawns;
+    message_t message;
+    coords_t position;
+    unsigned int slot;
+
+    printf("Player %d (%c) has entered the game.\n", context->number + 1, context->pseudo_name);
+    remaining_pawns = context->pawn_count - 1;
+    game_board = context->game_board;
+    /* Signal the master process this player is ready to place its pawns. */
+    ready_up(game_board);
+    /* Start listening for incoming messages. */
+    while (1){
+        /* Pull a message from the message queue. */
+        TRACE_BEGIN(trace_start);
+        message = receive_message(context->mq_id);
+        TRACE_END(TRACE_SPAN_RECEIVE, TRACE_TRACK_PLAYER(context->number), trace_start);
+        switch ( message.message_type ){
+            case 2: {
+                TRACE_BEGIN(trace_start);
+                if ( game_board->placement == PLACEMENT_BATCH ){
+                    /* Positions have been drawn in turns by the master process, place all the pawns at once. */
+                    for ( ; remaining_pawns >= 0 ; remaining_pawns-- ){
+                        slot = remaining_pawns * context->player_count + context->number;
+                        if ( get_planned_position(game_board, slot, &position) == 1 ){
+                            pawn_list[remaining_pawns] = spawn_pawn(game_board, context->pseudo_name, context->max_pawn_moves, &position, slot);
+                        }else{
+                            pawn_list[remaining_pawns] = spawn_pawn(game_board, context->pseudo_name, context->max_pawn_moves, NULL, slot);
+                        }
+                    }
+                    end_placement(game_board, 1);
+                }else if ( remaining_pawns >= 0 ){
+                    /* There are still pawns to place, place another pawn. */
+                    pawn_list[remaining_pawns] = spawn_pawn(game_board, context->pseudo_name, context->max_pawn_moves, NULL, remaining_pawns * context->player_count + context->number);
+                    remaining_pawns--;
+                    /* Inform the master process a pawn has been placed. */
+                    end_placement(game_board, 0);
+                }else{
+                    /* Inform the master process that all the pawns have been placed. */
+                    end_placement(game_board, 1);
+                }
+                TRACE_END(TRACE_SPAN_PLACEMENT, TRACE_TRACK_PLAYER(context->number), trace_start);
+            }break;
+            case 5: {
+                /* Flags have been spawned, send the pawns to them before getting ready as pawns read their target once the round is released. */
+                TRACE_BEGIN(trace_start);
+                plan_pawn_targets(game_board, context->number, context->player_count, context->pawn_count, context->max_pawn_moves);
+                TRACE_END(TRACE_SPAN_PLANNING, TRACE_TRACK_PLAYER(context->number), trace_start);
+                /* Inform the master process that this player is ready to play current round. */
+                organization_completed(game_board);
+            }break;
+            case 7: {
+                /* The round has been released through the game board, pawns running as tasks must be resumed. */
+                resume_pawns(game_board, pawn_list, context->pawn_count);
+            }break;
+            case 11:{
+                /* Signal all the player's pawns that they must terminate their processes. */
+                destroy_pawns(game_board, pawn_list, context->pawn_count);
+                return;
+            }
+            case 12: {
+                /**/
+                broadcast_signal_to_pawns(pawn_list, context->pawn_count, 12);
+            }break;
+        }
+    }
+}
+
+/**
+ * Sends the pawns of a player to the flags placed on the game board: pawn and flag pairs are visited from the closest to the
+ * farthest, each pair is taken if neither the pawn nor the flag has been taken yet, pairs out of the moves a pawn can do are skipped.
+ * Pawns that have not been sent to any flag will hold their position for the whole round.
+ *
+ * @param game_board The reference to the game board.
+ * @param player_number The number of the player, counting from zero.
+ * @param player_count The amount of players in the game.
+ * @param pawn_count The amount of pawns each player owns.
+ * @param max_moves The amount of moves each pawn can do during a round.
+ */
+void plan_pawn_targets(board_t* game_board, unsigned int player_number, unsigned int player_count, unsigned int pawn_count, unsigned int max_moves){
+    unsigned int i, k, slot, flag, distance, limit, placed, pair_count, assigned, *placed_slots, *buckets, *pairs;
+    boolean assigned_flags[MAX_FLAGS];
+    coords_t flag_coords[MAX_FLAGS], position;
+    pawn_slot_t* pawn_slots;
+
+    pawn_slots = get_pawn_slots(game_board);
+    /* No pawn can be farther than this from a flag. */
+    limit = game_board->width + game_board->height;
+    limit = max_moves < limit ? max_moves : limit;
+    placed_slots = (unsigned int*)malloc(sizeof(unsigned int) * ( pawn_count + 1 ));
+    buckets = (unsigned int*)calloc(limit + 2, sizeof(unsigned int));
+    pairs = (unsigned int*)malloc(sizeof(unsigned int) * ( pawn_count * game_board->flag_count + 1 ));
+    if ( placed_slots == NULL || buckets == NULL || pairs == NULL ){
+        printf("Cannot allocate the pawn targets, aborting.\n");
+        exit(3);
+    }
+    /* Sparse boards have fewer slots than cells, the slots of the pawns that could not be placed do not exist. */
+    placed = 0;
+    for ( k = 0 ; k < pawn_count && k * player_count + player_number < game_board->pawn_slot_count ; k++ ){
+        slot = k * player_count + player_number;
+        pawn_slots[slot].target = PAWN_TARGET_NONE;
+        /* Pawns that have not placed themselves yet are left out. */
+        if ( __atomic_load_n(&pawn_slots[slot].position, __ATOMIC_RELAXED) != PAWN_POSITION_UNKNOWN ){
+            placed_slots[placed++] = slot;
+        }
+    }
+    for ( flag = 0 ; flag < game_board->flag_count ; flag++ ){
+        compute_coords(game_board, game_board->flags[flag].index, &flag_coords[flag]);
+    }
+    /* Sort the pairs by distance, distances are small so they are counted first and then each pair is put in its bucket. */
+    pair_count = 0;
+    for ( k = 0 ; k < placed ; k++ ){
+        compute_coords(game_board, pawn_slots[placed_slots[k]].position, &position);
+        for ( flag = 0 ; flag < game_board->flag_count ; flag++ ){
+            distance = ( position.x > flag_coords[flag].x ? position.x - flag_coords[flag].x : flag_coords[flag].x - position.x ) + ( position.y > flag_coords[flag].y ? position.y - flag_coords[flag].y : flag_coords[flag].y - position.y );
+            if ( distance <= limit ){
+                buckets[distance + 1]++;
+                pair_count++;
+            }
+        }
+    }
+    for ( i = 1 ; i <= limit + 1 ; i++ ){
+        buckets[i] += buckets[i - 1];
+    }
+    for ( k = 0 ; k < placed ; k++ ){
+        compute_coords(game_board, pawn_slots[placed_slots[k]].position, &position);
+        for ( flag = 0 ; flag < game_board->flag_count ; flag++ ){
+            distance = ( position.x > flag_coords[flag].x ? position.x - flag_coords[flag].x : flag_coords[flag].x - position.x ) + ( position.y > flag_coords[flag].y ? position.y - flag_coords[flag].y : flag_coords[flag].y - position.y );
+            if ( distance <= limit ){
+                pairs[buckets[distance]++] = k * MAX_FLAGS + flag;
+            }
+        }
+    }
+    memset(assigned_flags, 0, sizeof(assigned_flags));
+    assigned = 0;
+    for ( i = 0 ; i < pair_count && assigned < game_board->flag_count ; i++ ){
+        slot = placed_slots[pairs[i] / MAX_FLAGS];
+        flag = pairs[i] % MAX_FLAGS;
+        if ( assigned_flags[flag] == 0 && pawn_slots[slot].target == PAWN_TARGET_NONE ){
+            assigned_flags[flag] = 1;
+            pawn_slots[slot].target = game_board->flags[flag].index;
+            assigned++;
+        }
+    }
+    free(placed_slots);
+    free(buckets);
+    free(pairs);
+}
+
+/**
+ * Entry point of the threads running a player.
+ *
+ * @param argument The reference to the player context, it will be released once the player has been terminated.
+ *
+ * @return Nothing.
+ *
+ * @private
+ */
+void* player_thread(void* argument){
+    run_player((player_context_t*)argument);
+    free(argument);
+    return NULL;
+}
+
+/**
+ * Generates the player processes, or threads if the game board has been configured to run everything in current process.
  *
  * @param player_list The reference to the list where player information will be stored in.
- * @param game_board_shm_id The ID of the shared memory segment where the game board is stored in.
+ * @param game_board The reference to the game board.
  * @param player_count An integer number representing the amount of players to spawn.
  * @param pawn_count An integer number representing the amount of pawns each player should spawn.
  * @param max_pawn_moves An integer number representing the amount of moves each pawn can do.
  */
-void spawn_players(player_t* player_list, int game_board_shm_id, unsigned int player_count, int pawn_count, unsigned int max_pawn_moves){
+void spawn_players(player_t* player_list, board_t* game_board, unsigned int player_count, int pawn_count, unsigned int max_pawn_moves){
+    player_context_t* context;
     pid_t player_pid;
-    char pseudo_name;
-    int player_mq_id;
     unsigned int i;
 
+    if ( player_count * pawn_count > game_board->pawn_slot_count ){
+        printf("Cannot fit %u pawns in the game board, aborting.\n", player_count * pawn_count);
+        exit(3);
+    }
     for ( i = 0 ; i < player_count ; i++ ){
-        pseudo_name = i + 65;
+        context = (player_context_t*)malloc(sizeof(player_context_t));
+        if ( context == NULL ){
+            printf("Cannot allocate the player, aborting.\n");
+            exit(3);
+        }
+        context->game_board = game_board;
+        context->pseudo_name = i + 65;
+        context->number = i;
+        context->player_count = player_count;
+        context->pawn_count = pawn_count;
+        context->max_pawn_moves = max_pawn_moves;
         /* Allocate a new message queue for current player. */
-        player_mq_id = generate_message_queue();
+        context->mq_id = open_message_queue(game_board);
+        /* Setup player's information. */
+        player_list[i].mq_id = context->mq_id;
+        player_list[i].pseudo_name = context->pseudo_name;
+        player_list[i].available_moves = pawn_count * max_pawn_moves;
+        player_list[i].total_moves = player_list[i].available_moves;
+        player_list[i].total_score = player_list[i].global_score = 0;
+        if ( game_board->execution_mode != EXECUTION_MODE_PROCESS ){
+            /* Run the player as a thread sharing the game board with current process. */
+            player_list[i].pid = getpid();
+            player_list[i].thread = start_thread(player_thread, context, PLAYER_STACK_SIZE);
+            continue;
+        }
+        /* Flush pending output so that it won't be duplicated by the child process. */
+        fflush(stdout);
         /* Create the player process. */
         player_pid = fork();
         if ( player_pid == -1 ){
             printf("Cannot fork process, aborting.\n");
             exit(3);
         }else if ( player_pid == 0 ){
-            pawn_t pawn_list[pawn_count];
-            board_t* game_board;
-            int remaining_pawns;
-            message_t message;
-
-            printf("Player %d (%c) has entered the game.\n", i + 1, pseudo_name);
-            remaining_pawns = pawn_count - 1;
-            /* Attach the game board to current process memory. */
-            game_board = get_board(game_board_shm_id);
-            /* Signal the master process this player is ready to place its pawns. */
-            ready_up(game_board);
-            /* Start listening for incoming messages. */
-            while (1){
-                /* Pull a message from the message queue. */
-                message = receive_message(player_mq_id);
-                switch ( message.message_type ){
-                    case 2: {
-                        if ( remaining_pawns >= 0 ){
-                            /* There are still pawns to place, place another pawn. */
-                            pawn_list[remaining_pawns] = spawn_pawn(game_board, pseudo_name, game_board_shm_id, max_pawn_moves);
-                            remaining_pawns--;
-                            /* Inform the master process a pawn has been placed. */
-                            end_placement(game_board, 0);
-                        }else{
-                            /* Inform the master process that all the pawns have been placed. */
-                            end_placement(game_board, 1);
-                        }
-                    }break;
-                    case 5: {
-                        /* Inform the master process that this player is ready to play current round. */
-                        organization_completed(game_board);
-                    }break;
-                    case 7: {
-                        broadcast_signal_to_pawns(pawn_list, pawn_count, 8);
-                    }break;
-                    case 9: {
-                        broadcast_signal_to_pawns(pawn_list, pawn_count, 9);
-                    }break;
-                    case 11:{
-                        /* Signal all the player's pawns that they must terminate their processes. */
-                        destroy_pawns(pawn_list, pawn_count);
-                        exit(0);
-                    }
-                    case 12: {
-                        /**/
-                        broadcast_signal_to_pawns(pawn_list, pawn_count, 12);
-                    }break;
-                }
-            }
-        }else{
-            /* Setup player's information. */
-            player_list[i].mq_id = player_mq_id;
-            player_list[i].pid = player_pid;
-            player_list[i].pseudo_name = pseudo_name;
-            player_list[i].available_moves = pawn_count * max_pawn_moves;
-            player_list[i].total_moves = player_list[i].available_moves;
-            player_list[i].total_score = player_list[i].global_score = 0;
+            /* The game board segment is inherited from the master process, the event log is not. */
+            fork_event_log();
+            run_player(context);
+            exit(0);
+        }
+        free(context);
+        player_list[i].pid = player_pid;
+    }
+}
+
+/**
+ * Waits for the given players to terminate, it must be called after they have been signaled to do so.
+ *
+ * @param game_board The reference to the game board.
+ * @param player_list A reference to the list of all the players to wait for.
+ * @param player_count The amount of players in the given list.
+ */
+void wait_for_players(board_t* game_board, player_t* player_list, unsigned int player_count){
+    unsigned int i;
+
+    if ( game_board->execution_mode != EXECUTION_MODE_PROCESS ){
+        for ( i = 0 ; i < player_count ; i++ ){
+            join_thread(player_list[i].thread);
+        }
+    }else{
+        for ( i = 0 ; i < player_count ; i++ ){
+            waitpid(player_list[i].pid, NULL, 0);
         }
     }
 }
@@ -252,13 +438,13 @@ unsigned int get_player_index(player_t* player_list, unsigned int player_count,
  * @return THe sum of the scores of all the flags conquered by the given player.
  */
 unsigned int get_player_score(board_t* game_board, char player_pseudo_name){
-    unsigned int i, length, score;
+    unsigned int i, score;
 
-    length = game_board->width * game_board->height;
     score = 0;
-    for ( i = 0 ; i < length ; i++ ){
-        if ( game_board->cells[i].player_pseudo_name == player_pseudo_name ){
-            score += game_board->cells[i].flag_score;
+    /* Walk the flag index, the board itself is never scanned. */
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        if ( __atomic_load_n(&game_board->flags[i].owner, __ATOMIC_ACQUIRE) == player_pseudo_name ){
+            score += game_board->flags[i].score;
         }
     }
     return score;
@@ -273,10 +459,20 @@ unsigned int get_player_score(board_t* game_board, char player_pseudo_name){
  * @param update_glob If set to "1" the "global_score" property will be incremented by the total value computed.
  */
 void update_players_score(board_t* game_board, player_t* player_list, unsigned int player_count, boolean update_glob){
+    unsigned int scores[MAX_PLAYERS];
     unsigned int i;
+    char owner;
 
+    /* Sum the scores of all the players in a single pass over the flag index. */
+    memset(scores, 0, sizeof(scores));
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        owner = __atomic_load_n(&game_board->flags[i].owner, __ATOMIC_ACQUIRE);
+        if ( owner != 0 ){
+            scores[owner - 65] += game_board->flags[i].score;
+        }
+    }
     for ( i = 0 ; i < player_count ; i++ ){
-        player_list[i].total_score = get_player_score(game_board, player_list[i].pseudo_name);
+        player_list[i].total_score = scores[player_list[i].pseudo_name - 65];
     }
     if ( update_glob == 1 ){
         for ( i = 0 ; i < player_count ; i++ ){
@@ -284,3 +480,40 @@ void update_players_score(board_t* game_board, player_t* player_list, unsigned i
         }
     }
 }
+
+/**
+ * Updates the remaining moves of each player contained in the given list according to the counters stored in the game board.
+ *
+ * @param game_board The reference to the game board.
+ * @param player_list A reference to the list of all the players.
+ * @param player_count The amount of players in the given list.
+ *
+ * @return The amount of moves done by all the players since the counters were reset.
+ */
+unsigned int update_players_moves(board_t* game_board, player_t* player_list, unsigned int player_count){
+    unsigned int i, used_moves, total;
+
+    total = 0;
+    for ( i = 0 ; i < player_count ; i++ ){
+        used_moves = __atomic_load_n(&game_board->used_moves[player_list[i].pseudo_name - 65], __ATOMIC_RELAXED);
+        player_list[i].available_moves = used_moves < player_list[i].total_moves ? player_list[i].total_moves - used_moves : 0;
+        total += used_moves;
+    }
+    return total;
+}
+
+/**
+ * Resets the moves counters stored in the game board, it must be called when no pawn is moving.
+ *
+ * @param game_board The reference to the game board.
+ * @param player_list A reference to the list of all the players.
+ * @param player_count The amount of players in the given list.
+ */
+void reset_players_moves(board_t* game_board, player_t* player_list, unsigned int player_count){
+    unsigned int i;
+
+    for ( i = 0 ; i < player_count ; i++ ){
+        __atomic_store_n(&game_board->used_moves[player_list[i].pseudo_name - 65], 0, __ATOMIC_RELAXED);
+        player_list[i].available_moves = player_list[i].total_moves;
+    }
+}
@@ -3,11 +3,15 @@
 
 #include "types.h"
 
-void spawn_players(player_t* player_list, int game_board_shm_id, unsigned int player_count, int pawn_count, unsigned int max_pawn_moves);
+void plan_pawn_targets(board_t* game_board, unsigned int player_number, unsigned int player_count, unsigned int pawn_count, unsigned int max_moves);
+void spawn_players(player_t* player_list, board_t* game_board, unsigned int player_count, int pawn_count, unsigned int max_pawn_moves);
 void update_players_score(board_t* game_board, player_t* player_list, unsigned int player_count, boolean update_glob);
+unsigned int update_players_moves(board_t* game_board, player_t* player_list, unsigned int player_count);
 unsigned int get_player_index(player_t* player_list, unsigned int player_count, char player_pseudo_name);
 void broadcast_message_to_players(player_t* player_list, unsigned int player_count, message_t* message);
 void broadcast_signal_to_players(player_t* player_list, unsigned int player_count, unsigned short type);
+void reset_players_moves(board_t* game_board, player_t* player_list, unsigned int player_count);
+void wait_for_players(board_t* game_board, player_t* player_list, unsigned int player_count);
 unsigned int get_player_score(board_t* game_board, char player_pseudo_name);
 void allow_pawn_placing(player_t* player);
 
@@ -0,0 +1,117 @@
+#include "random.h"
+
+#include <limits.h>
+
+#include "types.h"
+
+/**
+ * Rotates the bits of a 32 bit word to the left.
+ *
+ * @param value The word to rotate.
+ * @param count The amount of bits to rotate by.
+ *
+ * @return The rotated word.
+ *
+ * @private
+ */
+unsigned int rotate_left(unsigned int value, unsigned int count){
+    return ( value << count ) | ( value >> ( 32 - count ) );
+}
+
+/**
+ * Advances a splitmix counter and returns the next well mixed word, it is used to expand seeds into generator states.
+ *
+ * @param counter The reference to the counter.
+ *
+ * @return A 32 bit word.
+ *
+ * @private
+ */
+unsigned int next_seed_word(unsigned int* counter){
+    unsigned int word;
+
+    *counter += 0x9e3779b9U;
+    word = *counter;
+    word = ( word ^ ( word >> 16 ) ) * 0x85ebca6bU;
+    word = ( word ^ ( word >> 13 ) ) * 0xc2b2ae35U;
+    return word ^ ( word >> 16 );
+}
+
+/**
+ * Initializes a generator on the stream identified by the given number, generators sharing the seed but using different streams
+ * produce unrelated sequences so that each pawn can own one without sharing any state.
+ *
+ * @param generator The reference to the generator to initialize.
+ * @param seed The seed of the whole game.
+ * @param stream The number of the stream.
+ */
+void seed_random(random_t* generator, unsigned long seed, unsigned int stream){
+    unsigned int counter, i;
+
+    /* Fold the seed and the stream into the splitmix counter, each step is mixed so that close values diverge. */
+    counter = (unsigned int)( seed & 0xffffffffUL );
+    counter = next_seed_word(&counter) ^ (unsigned int)( ( seed >> 16 ) >> 16 );
+    counter = next_seed_word(&counter) ^ stream;
+    for ( i = 0 ; i < 4 ; i++ ){
+        generator->state[i] = next_seed_word(&counter);
+    }
+    if ( ( generator->state[0] | generator->state[1] | generator->state[2] | generator->state[3] ) == 0 ){
+        /* An all zero state would only ever produce zeros. */
+        generator->state[0] = 1;
+    }
+}
+
+/**
+ * Returns the next 32 bit word of the given generator (xoshiro128**).
+ *
+ * @param generator The reference to the generator.
+ *
+ * @return A random 32 bit word.
+ */
+unsigned int next_random(random_t* generator){
+    unsigned int result, t;
+
+    result = rotate_left(generator->state[1] * 5, 7) * 9;
+    t = generator->state[1] << 9;
+    generator->state[2] ^= generator->state[0];
+    generator->state[3] ^= generator->state[1];
+    generator->state[1] ^= generator->state[2];
+    generator->state[0] ^= generator->state[3];
+    generator->state[2] ^= t;
+    generator->state[3] = rotate_left(generator->state[3], 11);
+    return result;
+}
+
+/**
+ * Returns a random number lower than the given bound without the bias a plain modulo would introduce.
+ *
+ * @param generator The reference to the generator.
+ * @param bound The upper bound (excluded), it must be greater than zero.
+ *
+ * @return A number between 0 and bound - 1.
+ */
+unsigned int random_below(random_t* generator, unsigned int bound){
+#if ULONG_MAX > 0xffffffffUL
+    unsigned long product;
+    unsigned int threshold;
+
+    /* Lemire's method: the high half of the product is the result, the low half tells if it falls in the biased range. */
+    product = (unsigned long)next_random(generator) * bound;
+    if ( (unsigned int)product < bound ){
+        threshold = ( 0U - bound ) % bound;
+        while ( (unsigned int)product < threshold ){
+            product = (unsigned long)next_random(generator) * bound;
+        }
+    }
+    return (unsigned int)( product >> 32 );
+#else
+    unsigned int threshold, value;
+
+    /* No 64 bit product available, reject the values falling in the biased range instead. */
+    threshold = ( 0U - bound ) % bound;
+    do {
+        value = next_random(generator);
+    } while ( value < threshold );
+    return value % bound;
+#endif
+}
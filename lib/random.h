@@ -0,0 +1,10 @@
+#ifndef PROCHESS_RANDOM_H
+#define PROCHESS_RANDOM_H
+
+#include "types.h"
+
+void seed_random(random_t* generator, unsigned long seed, unsigned int stream);
+unsigned int random_below(random_t* generator, unsigned int bound);
+unsigned int next_random(random_t* generator);
+
+#endif
@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "board.h"
+#include "types.h"
+
+/**
+ * The event log current process writes to, its directory is NULL until recording is started.
+ */
+event_log_t event_log;
+
+/**
+ * Returns the size of an event log file holding the given amount of records.
+ *
+ * @param length The amount of records.
+ *
+ * @return The size in bytes.
+ *
+ * @private
+ */
+size_t compute_event_log_size(unsigned long length){
+    return sizeof(event_log_header_t) + sizeof(event_record_t) * length;
+}
+
+/**
+ * Creates the event log file of current process and maps it in memory, the file is sized for EVENT_LOG_MAX_RECORDS records but
+ * only the pages that get written take space on disk.
+ *
+ * @private
+ */
+void open_event_log(){
+    char path[4096];
+    void* segment;
+
+    sprintf(path, "%.4000s/prochess-%d.events", event_log.directory, (int)getpid());
+    event_log.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( event_log.fd == -1 || ftruncate(event_log.fd, (off_t)compute_event_log_size(EVENT_LOG_MAX_RECORDS)) != 0 ){
+        printf("Cannot create the event log %s, aborting.\n", path);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    segment = mmap(NULL, compute_event_log_size(EVENT_LOG_MAX_RECORDS), PROT_READ | PROT_WRITE, MAP_SHARED, event_log.fd, 0);
+    if ( segment == MAP_FAILED ){
+        printf("Cannot map the event log %s, aborting.\n", path);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    event_log.header = (event_log_header_t*)segment;
+    event_log.records = (event_record_t*)( (char*)segment + sizeof(event_log_header_t) );
+    memcpy(event_log.header->magic, EVENT_LOG_MAGIC, sizeof(event_log.header->magic));
+    event_log.header->version = EVENT_LOG_VERSION;
+    event_log.header->record_size = sizeof(event_record_t);
+    event_log.header->pid = (int)getpid();
+}
+
+/**
+ * Unmaps the event log file of current process, the file is truncated to the records written when requested.
+ *
+ * @param truncate If set to "1" the room left in the file is given back.
+ *
+ * @private
+ */
+void close_event_log(boolean truncate){
+    unsigned long length;
+
+    if ( event_log.header == NULL ){
+        return;
+    }
+    if ( truncate == 1 ){
+        length = __atomic_load_n(&event_log.header->length, __ATOMIC_ACQUIRE);
+        length = length < EVENT_LOG_MAX_RECORDS ? length : EVENT_LOG_MAX_RECORDS;
+        __atomic_store_n(&event_log.header->length, length, __ATOMIC_RELEASE);
+        ftruncate(event_log.fd, (off_t)compute_event_log_size(length));
+    }
+    munmap(event_log.header, compute_event_log_size(EVENT_LOG_MAX_RECORDS));
+    close(event_log.fd);
+    event_log.header = NULL;
+    event_log.records = NULL;
+}
+
+/**
+ * Starts recording the events of the game, every process writes its own file in the given directory.
+ *
+ * @param directory The path to the directory, it is created if it doesn't exist.
+ */
+void start_event_log(const char* directory){
+    if ( mkdir(directory, 0755) == -1 && errno != EEXIST ){
+        printf("Cannot create the event log directory %s, aborting.\n", directory);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    event_log.directory = directory;
+    event_log.header = NULL;
+    event_log.records = NULL;
+    /* Registered once, forked processes inherit it and give back the room left in their own files. */
+    atexit(stop_event_log);
+    open_event_log();
+}
+
+/**
+ * Lets go of the event log inherited from the parent process, it must be called by a process right after it has been forked.
+ */
+void fork_event_log(){
+    close_event_log(0);
+}
+
+/**
+ * Appends an event to the event log of current process, it does nothing unless recording has been started. Threads of the
+ * same process may record events concurrently, events that don't fit in the file are counted and dropped.
+ *
+ * @param type The type of the event (EVENT_*).
+ * @param player_pseudo_name The pseudo name of the player the event is about, "0" if none.
+ * @param slot The slot of the pawn the event is about, or the meaning given by the type.
+ * @param from The position the event starts at, or the meaning given by the type.
+ * @param to The position the event ends at, or the meaning given by the type.
+ * @param value The value the event carries, its meaning is given by the type.
+ */
+void record_event(unsigned char type, char player_pseudo_name, unsigned int slot, unsigned int from, unsigned int to, unsigned int value){
+    struct timespec now;
+    event_record_t* record;
+    unsigned long index;
+
+    if ( event_log.header == NULL ){
+        if ( event_log.directory == NULL ){
+            return;
+        }
+        open_event_log();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    index = __atomic_fetch_add(&event_log.header->length, 1, __ATOMIC_RELAXED);
+    if ( index >= EVENT_LOG_MAX_RECORDS ){
+        __atomic_add_fetch(&event_log.header->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    record = &event_log.records[index];
+    record->timestamp = (unsigned long)now.tv_sec * 1000000000UL + (unsigned long)now.tv_nsec;
+    record->slot = slot;
+    record->from = from;
+    record->to = to;
+    record->value = value;
+    record->player_pseudo_name = player_pseudo_name;
+    /* Written last, readers skip the records reserved by a process that died before filling them in. */
+    __atomic_store_n(&record->type, type, __ATOMIC_RELEASE);
+}
+
+/**
+ * Records the flags spawned for the round about to start.
+ *
+ * @param game_board The reference to the game board.
+ */
+void record_flags(board_t* game_board){
+    coords_t coords;
+    unsigned int i;
+
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        compute_coords(game_board, game_board->flags[i].index, &coords);
+        record_event(EVENT_FLAG, 0, i, 0, coords.y * game_board->width + coords.x, game_board->flags[i].score);
+    }
+}
+
+/**
+ * Stops recording, the event log file of current process is truncated to the records it holds.
+ */
+void stop_event_log(){
+    close_event_log(1);
+    /* Events recorded from now on are ignored instead of starting the file over. */
+    event_log.directory = NULL;
+}
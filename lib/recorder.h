@@ -0,0 +1,12 @@
+#ifndef PROCHESS_RECORDER_H
+#define PROCHESS_RECORDER_H
+
+#include "types.h"
+
+void record_event(unsigned char type, char player_pseudo_name, unsigned int slot, unsigned int from, unsigned int to, unsigned int value);
+void start_event_log(const char* directory);
+void record_flags(board_t* game_board);
+void fork_event_log();
+void stop_event_log();
+
+#endif
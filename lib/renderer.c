@@ -0,0 +1,270 @@
+#include "renderer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "types.h"
+
+/**
+ * The largest piece of text appended at once: a cell holding a conquered flag along with the cursor movement preceding it.
+ */
+#define RENDERER_MAX_PIECE 64
+
+/**
+ * Writes out the text built so far, anything printed through stdio is flushed first so that the output is kept in order.
+ *
+ * @param renderer The reference to the renderer.
+ *
+ * @private
+ */
+void flush_renderer(renderer_t* renderer){
+    size_t written;
+    ssize_t result;
+
+    if ( renderer->length == 0 ){
+        return;
+    }
+    fflush(stdout);
+    written = 0;
+    while ( written < renderer->length ){
+        result = write(renderer->fd, renderer->buffer + written, renderer->length - written);
+        if ( result == -1 ){
+            if ( errno == EINTR ){
+                continue;
+            }
+            /* The terminal is gone, there is nobody left to draw the board for. */
+            break;
+        }
+        written += (size_t)result;
+    }
+    renderer->length = 0;
+}
+
+/**
+ * Appends some text to the buffer, the buffer is written out first if the text doesn't fit in it.
+ *
+ * @param renderer The reference to the renderer.
+ * @param text The text to append, it must not be longer than RENDERER_MAX_PIECE.
+ * @param length The length of the text.
+ *
+ * @private
+ */
+void append_text(renderer_t* renderer, const char* text, size_t length){
+    if ( renderer->length + length > renderer->capacity ){
+        flush_renderer(renderer);
+    }
+    memcpy(renderer->buffer + renderer->length, text, length);
+    renderer->length += length;
+}
+
+/**
+ * Appends the content of a cell, including the border on its left.
+ *
+ * @param renderer The reference to the renderer.
+ * @param cell The cell to draw.
+ *
+ * @private
+ */
+void append_cell(renderer_t* renderer, cell_t cell){
+    char text[RENDERER_MAX_PIECE];
+
+    switch ( CELL_OCCUPANT_TYPE(cell) ){
+        case 1: {
+            /* This cell contains a flag. */
+            if ( CELL_PLAYER_PSEUDO_NAME(cell) > 0 ){
+                /* This flag has been conquered by a process. */
+                append_text(renderer, text, (size_t)sprintf(text, "|\033[1;34m♟\033[0m-\033[31m⚑%c\033[0m", CELL_PLAYER_PSEUDO_NAME(cell)));
+            }else{
+                append_text(renderer, "|  \033[34m⚑\033[0m ", sizeof("|  \033[34m⚑\033[0m ") - 1);
+            }
+        }break;
+        case 2: {
+            /* This cell contains a pawn. */
+            append_text(renderer, text, (size_t)sprintf(text, "| \033[1;34m♟\033[0m%c ", CELL_PLAYER_PSEUDO_NAME(cell)));
+        }break;
+        default: {
+            /* This is an empty cell. */
+            append_text(renderer, "|    ", 5);
+        }break;
+    }
+}
+
+/**
+ * Appends the label of a column or of a row, labels are padded with zeros to three digits.
+ *
+ * @param renderer The reference to the renderer.
+ * @param prefix The text preceding the number.
+ * @param number The number of the column or of the row, starting from 1.
+ *
+ * @private
+ */
+void append_label(renderer_t* renderer, const char* prefix, unsigned int number){
+    char text[RENDERER_MAX_PIECE];
+
+    append_text(renderer, text, (size_t)sprintf(text, number < 10 ? "%s00%u" : ( number < 100 ? "%s0%u" : "%s%u" ), prefix, number));
+}
+
+/**
+ * Draws the whole board, the cells drawn are remembered when the renderer is live.
+ *
+ * @param renderer The reference to the renderer.
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void render_frame(renderer_t* renderer, board_t* game_board){
+    char text[RENDERER_MAX_PIECE];
+    unsigned int x, y;
+    cell_t cell;
+
+    if ( renderer->live == 1 ){
+        /* Clear the screen and draw the board at its top. */
+        append_text(renderer, "\033[H\033[2J", 7);
+    }
+    /* Draw the x axis. */
+    append_text(renderer, "\n    ", 5);
+    for ( x = 1 ; x <= renderer->width ; x++ ){
+        append_label(renderer, "| ", x);
+    }
+    append_text(renderer, "|\n    |", 7);
+    /* Draw the separator after the x axis header. */
+    for ( x = 1 ; x <= renderer->width ; x++ ){
+        append_text(renderer, "-----", x == 1 ? 4 : 5);
+    }
+    append_text(renderer, "|\n", 2);
+    for ( y = 0 ; y < renderer->height ; y++ ){
+        /* Draw the left block of the y axis, then a whole row. */
+        append_label(renderer, " ", y + 1);
+        for ( x = 0 ; x < renderer->width ; x++ ){
+            cell = load_cell(game_board, compute_index_from_params(game_board, x, y));
+            append_cell(renderer, cell);
+            if ( renderer->live == 1 ){
+                renderer->drawn_cells[y * renderer->width + x] = cell & CELL_OCCUPANT_MASK;
+            }
+        }
+        append_text(renderer, "|\n    |", 7);
+        /* Draw the row separator, its second piece is one character shorter. */
+        for ( x = 1 ; x <= renderer->width ; x++ ){
+            append_text(renderer, "-----", x == 2 ? 4 : 5);
+        }
+        append_text(renderer, "|\n", 2);
+    }
+    append_text(renderer, "\n", 1);
+    if ( renderer->live == 1 ){
+        /* Whatever is printed next scrolls below the board instead of pushing it away. */
+        append_text(renderer, text, (size_t)sprintf(text, "\033[%ur\033[%u;1H", 2 * renderer->height + 5, 2 * renderer->height + 5));
+    }
+    renderer->drawn = 1;
+}
+
+/**
+ * Draws the cells that have changed since the last frame, the cursor is moved to each of them and then put back.
+ *
+ * @param renderer The reference to the renderer.
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void render_changes(renderer_t* renderer, board_t* game_board){
+    char text[RENDERER_MAX_PIECE];
+    unsigned int x, y, column;
+    boolean moved;
+    cell_t cell;
+
+    moved = 0;
+    for ( y = 0 ; y < renderer->height ; y++ ){
+        /* Rows start after the label, which is four characters long unless the row number has more than three digits. */
+        column = y + 1 < 1000 ? 5 : (unsigned int)sprintf(text, " %u", y + 1) + 1;
+        for ( x = 0 ; x < renderer->width ; x++ ){
+            cell = load_cell(game_board, compute_index_from_params(game_board, x, y)) & CELL_OCCUPANT_MASK;
+            if ( renderer->drawn_cells[y * renderer->width + x] == cell ){
+                continue;
+            }
+            renderer->drawn_cells[y * renderer->width + x] = cell;
+            if ( moved == 0 ){
+                /* Save the cursor, it is put back once every change has been drawn. */
+                append_text(renderer, "\0337", 2);
+                moved = 1;
+            }
+            append_text(renderer, text, (size_t)sprintf(text, "\033[%u;%uH", 2 * y + 4, column + 5 * x));
+            append_cell(renderer, cell);
+        }
+    }
+    if ( moved == 1 ){
+        append_text(renderer, "\0338", 2);
+    }
+}
+
+/**
+ * Creates a renderer for the given board.
+ *
+ * @param game_board The reference to the game board.
+ * @param fd The descriptor the frames are written to.
+ * @param live If set to "1" the board is drawn at the top of the terminal and then only the cells that have changed are drawn.
+ *
+ * @return The reference to the renderer created.
+ */
+renderer_t* create_renderer(board_t* game_board, int fd, boolean live){
+    renderer_t* renderer;
+    size_t frame_size;
+
+    renderer = (renderer_t*)malloc(sizeof(renderer_t));
+    if ( renderer == NULL ){
+        printf("Cannot allocate the board renderer, aborting.\n");
+        exit(1);
+    }
+    renderer->fd = fd;
+    renderer->live = live;
+    renderer->drawn = 0;
+    renderer->width = game_board->width;
+    renderer->height = game_board->height;
+    renderer->length = 0;
+    renderer->drawn_cells = NULL;
+    /* A buffer as large as the whole frame, where every cell holds a conquered flag, makes each frame a single write. */
+    frame_size = ( (size_t)game_board->width * 30 + 16 ) * ( (size_t)game_board->height + 1 ) * 2 + RENDERER_MAX_PIECE;
+    renderer->capacity = frame_size < RENDERER_MAX_BUFFER ? frame_size : RENDERER_MAX_BUFFER;
+    renderer->buffer = (char*)malloc(renderer->capacity);
+    if ( live == 1 ){
+        renderer->drawn_cells = (cell_t*)malloc(sizeof(cell_t) * game_board->width * game_board->height);
+    }
+    if ( renderer->buffer == NULL || ( live == 1 && renderer->drawn_cells == NULL ) ){
+        printf("Cannot allocate the board renderer, aborting.\n");
+        exit(1);
+    }
+    return renderer;
+}
+
+/**
+ * Draws the game board, a live renderer draws only the cells that have changed once the first frame has been drawn.
+ *
+ * @param renderer The reference to the renderer.
+ * @param game_board The reference to the game board.
+ */
+void render_board(renderer_t* renderer, board_t* game_board){
+    if ( renderer->live == 1 && renderer->drawn == 1 ){
+        render_changes(renderer, game_board);
+    }else{
+        render_frame(renderer, game_board);
+    }
+    flush_renderer(renderer);
+}
+
+/**
+ * Destroys the given renderer, the whole terminal scrolls again if the renderer was live.
+ *
+ * @param renderer The reference to the renderer.
+ */
+void destroy_renderer(renderer_t* renderer){
+    if ( renderer->live == 1 && renderer->drawn == 1 ){
+        /* Resetting the scroll region moves the cursor, so it is saved and put back. */
+        append_text(renderer, "\0337\033[r\0338", 7);
+        flush_renderer(renderer);
+    }
+    free(renderer->drawn_cells);
+    free(renderer->buffer);
+    free(renderer);
+}
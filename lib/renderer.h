@@ -0,0 +1,10 @@
+#ifndef PROCHESS_RENDERER_H
+#define PROCHESS_RENDERER_H
+
+#include "types.h"
+
+renderer_t* create_renderer(board_t* game_board, int fd, boolean live);
+void render_board(renderer_t* renderer, board_t* game_board);
+void destroy_renderer(renderer_t* renderer);
+
+#endif
@@ -0,0 +1,524 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "scheduler.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "thread.h"
+#include "types.h"
+
+/**
+ * The task is parked, it will run again only once it is submitted.
+ */
+#define TASK_STATE_IDLE 0
+
+/**
+ * The task is waiting in a deque to be picked up by a worker.
+ */
+#define TASK_STATE_QUEUED 1
+
+/**
+ * The task is being run by a worker.
+ */
+#define TASK_STATE_RUNNING 2
+
+/**
+ * The task has been submitted while running, it must run again as soon as it yields.
+ */
+#define TASK_STATE_NOTIFIED 3
+
+/**
+ * The task is waiting in the timer heap of a worker.
+ */
+#define TASK_STATE_SLEEPING 4
+
+/**
+ * The task has completed.
+ */
+#define TASK_STATE_FINISHED 5
+
+/**
+ * The stack size of the worker threads.
+ */
+#define WORKER_STACK_SIZE 262144
+
+/**
+ * Returns the current value of the monotonic clock.
+ *
+ * @return A floating point number representing the current time in seconds.
+ *
+ * @private
+ */
+double get_scheduler_time(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Appends a task at the bottom of the given deque, the deque grows whenever it is full.
+ *
+ * @param deque The reference to the deque.
+ * @param task The reference to the task to append.
+ *
+ * @private
+ */
+void push_task(task_deque_t* deque, task_t* task){
+    task_t** tasks;
+    unsigned int i;
+
+    pthread_mutex_lock(&deque->mutex);
+    if ( deque->count == deque->capacity ){
+        tasks = (task_t**)malloc(sizeof(task_t*) * deque->capacity * 2);
+        if ( tasks == NULL ){
+            printf("Cannot schedule the task, aborting.\n");
+            exit(6);
+        }
+        for ( i = 0 ; i < deque->count ; i++ ){
+            tasks[i] = deque->tasks[( deque->head + i ) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[( deque->head + deque->count ) % deque->capacity] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->mutex);
+}
+
+/**
+ * Removes a task from the given deque.
+ *
+ * @param deque The reference to the deque.
+ * @param steal If set to "1" the oldest task will be taken from the top, otherwise the newest one from the bottom.
+ *
+ * @return The reference to the task removed or NULL if the deque is empty.
+ *
+ * @private
+ */
+task_t* pop_task(task_deque_t* deque, boolean steal){
+    task_t* task;
+
+    task = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if ( deque->count > 0 ){
+        if ( steal == 1 ){
+            task = deque->tasks[deque->head];
+            deque->head = ( deque->head + 1 ) % deque->capacity;
+        }else{
+            task = deque->tasks[( deque->head + deque->count - 1 ) % deque->capacity];
+        }
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return task;
+}
+
+/**
+ * Puts a task in the deque of the given worker and wakes up an idle worker if any.
+ *
+ * @param worker The reference to the worker the task will be assigned to.
+ * @param task The reference to the task.
+ *
+ * @private
+ */
+void enqueue_task(worker_t* worker, task_t* task){
+    scheduler_t* scheduler;
+
+    scheduler = worker->scheduler;
+    push_task(&worker->deque, task);
+    __atomic_add_fetch(&scheduler->queued_tasks, 1, __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&scheduler->idle_workers, __ATOMIC_SEQ_CST) > 0 ){
+        pthread_mutex_lock(&scheduler->mutex);
+        pthread_cond_signal(&scheduler->work_available);
+        pthread_mutex_unlock(&scheduler->mutex);
+    }
+}
+
+/**
+ * Stores a sleeping task at the given position of the timer heap of the given worker.
+ *
+ * @param worker The reference to the worker owning the heap.
+ * @param index The position in the heap.
+ * @param task The reference to the task.
+ *
+ * @private
+ */
+void place_timer(worker_t* worker, unsigned int index, task_t* task){
+    worker->timers[index] = task;
+    task->timer_index = index;
+}
+
+/**
+ * Moves the task at the given position of the timer heap up or down until the heap is ordered by wake time again.
+ *
+ * @param worker The reference to the worker owning the heap.
+ * @param index The position of the task in the heap.
+ *
+ * @private
+ */
+void sift_timer(worker_t* worker, unsigned int index){
+    unsigned int parent, child;
+    task_t* task;
+
+    task = worker->timers[index];
+    /* Sift the task up until its parent wakes earlier. */
+    while ( index > 0 ){
+        parent = ( index - 1 ) / 2;
+        if ( worker->timers[parent]->wake_time <= task->wake_time ){
+            break;
+        }
+        place_timer(worker, index, worker->timers[parent]);
+        index = parent;
+    }
+    /* Then down until its children wake later. */
+    while ( ( child = index * 2 + 1 ) < worker->timer_count ){
+        if ( child + 1 < worker->timer_count && worker->timers[child + 1]->wake_time < worker->timers[child]->wake_time ){
+            child++;
+        }
+        if ( task->wake_time <= worker->timers[child]->wake_time ){
+            break;
+        }
+        place_timer(worker, index, worker->timers[child]);
+        index = child;
+    }
+    place_timer(worker, index, task);
+}
+
+/**
+ * Inserts a sleeping task in the timer heap of the given worker, the heap is ordered by wake time. The timer mutex must be held.
+ *
+ * @param worker The reference to the worker owning the heap.
+ * @param task The reference to the task.
+ *
+ * @private
+ */
+void add_timer(worker_t* worker, task_t* task){
+    task_t** timers;
+
+    if ( worker->timer_count == worker->timer_capacity ){
+        timers = (task_t**)realloc(worker->timers, sizeof(task_t*) * worker->timer_capacity * 2);
+        if ( timers == NULL ){
+            printf("Cannot schedule the task, aborting.\n");
+            exit(6);
+        }
+        worker->timers = timers;
+        worker->timer_capacity *= 2;
+    }
+    task->timer_worker = worker->index;
+    place_timer(worker, worker->timer_count++, task);
+    sift_timer(worker, task->timer_index);
+}
+
+/**
+ * Removes the task at the given position from the timer heap of the given worker. The timer mutex must be held.
+ *
+ * @param worker The reference to the worker owning the heap.
+ * @param index The position of the task in the heap, the first task to wake is at 0.
+ *
+ * @return The reference to the task removed.
+ *
+ * @private
+ */
+task_t* remove_timer(worker_t* worker, unsigned int index){
+    task_t* task;
+
+    task = worker->timers[index];
+    worker->timer_count--;
+    if ( index < worker->timer_count ){
+        /* The last task takes its place and is sifted from there. */
+        place_timer(worker, index, worker->timers[worker->timer_count]);
+        sift_timer(worker, index);
+    }
+    return task;
+}
+
+/**
+ * Moves every task whose wake time has passed from the timer heap to the deque of the given worker.
+ *
+ * @param worker The reference to the worker.
+ * @param now The current time in seconds.
+ *
+ * @private
+ */
+void fire_timers(worker_t* worker, double now){
+    task_t* task;
+
+    pthread_mutex_lock(&worker->timer_mutex);
+    while ( worker->timer_count > 0 && worker->timers[0]->wake_time <= now ){
+        task = remove_timer(worker, 0);
+        __atomic_store_n(&task->state, TASK_STATE_QUEUED, __ATOMIC_RELEASE);
+        enqueue_task(worker, task);
+    }
+    pthread_mutex_unlock(&worker->timer_mutex);
+}
+
+/**
+ * Looks for a task to run, first in the deque of the given worker and then in the deques of the other workers.
+ *
+ * @param worker The reference to the worker.
+ *
+ * @return The reference to the task found or NULL if there is nothing to run.
+ *
+ * @private
+ */
+task_t* find_task(worker_t* worker){
+    scheduler_t* scheduler;
+    unsigned int i;
+    task_t* task;
+
+    scheduler = worker->scheduler;
+    task = pop_task(&worker->deque, 0);
+    for ( i = 1 ; task == NULL && i < scheduler->worker_count ; i++ ){
+        task = pop_task(&scheduler->workers[( worker->index + i ) % scheduler->worker_count].deque, 1);
+    }
+    if ( task != NULL ){
+        __atomic_sub_fetch(&scheduler->queued_tasks, 1, __ATOMIC_SEQ_CST);
+    }
+    return task;
+}
+
+/**
+ * Runs a task and then parks it, puts it to sleep or completes it according to what its routine returned.
+ *
+ * @param worker The reference to the worker running the task.
+ * @param task The reference to the task.
+ *
+ * @private
+ */
+void run_task(worker_t* worker, task_t* task){
+    unsigned int expected;
+    long result;
+
+    __atomic_store_n(&task->state, TASK_STATE_RUNNING, __ATOMIC_RELEASE);
+    result = task->routine(task->argument);
+    if ( result == TASK_DONE ){
+        pthread_mutex_lock(&worker->scheduler->mutex);
+        __atomic_store_n(&task->state, TASK_STATE_FINISHED, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&worker->scheduler->task_finished);
+        pthread_mutex_unlock(&worker->scheduler->mutex);
+    }else if ( result == TASK_PARK ){
+        expected = TASK_STATE_RUNNING;
+        if ( !__atomic_compare_exchange_n(&task->state, &expected, TASK_STATE_IDLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ){
+            /* The task has been submitted while running, run it again. */
+            __atomic_store_n(&task->state, TASK_STATE_QUEUED, __ATOMIC_RELEASE);
+            enqueue_task(worker, task);
+        }
+    }else if ( result == 0 ){
+        /* The task asks to run again right away. */
+        __atomic_store_n(&task->state, TASK_STATE_QUEUED, __ATOMIC_RELEASE);
+        enqueue_task(worker, task);
+    }else{
+        /* Submitting the task while it sleeps takes it out of the heap, so the timer mutex is held until it is in there. */
+        task->wake_time = get_scheduler_time() + (double)result / 1000000000.0;
+        expected = TASK_STATE_RUNNING;
+        pthread_mutex_lock(&worker->timer_mutex);
+        if ( __atomic_compare_exchange_n(&task->state, &expected, TASK_STATE_SLEEPING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ){
+            add_timer(worker, task);
+            pthread_mutex_unlock(&worker->timer_mutex);
+        }else{
+            /* The task has been submitted while running, run it again now. */
+            pthread_mutex_unlock(&worker->timer_mutex);
+            __atomic_store_n(&task->state, TASK_STATE_QUEUED, __ATOMIC_RELEASE);
+            enqueue_task(worker, task);
+        }
+    }
+}
+
+/**
+ * Puts the given worker to sleep until some task is queued or its first timer expires.
+ *
+ * @param worker The reference to the worker.
+ *
+ * @private
+ */
+void wait_for_work(worker_t* worker){
+    scheduler_t* scheduler;
+    struct timespec deadline;
+    boolean sleeping;
+    double wake_time;
+
+    scheduler = worker->scheduler;
+    /* Read before taking the scheduler mutex, as timers are fired with the timer mutex held; a task submitted meanwhile only wakes the worker early. */
+    pthread_mutex_lock(&worker->timer_mutex);
+    sleeping = worker->timer_count > 0 ? 1 : 0;
+    wake_time = sleeping == 1 ? worker->timers[0]->wake_time : 0;
+    pthread_mutex_unlock(&worker->timer_mutex);
+    pthread_mutex_lock(&scheduler->mutex);
+    __atomic_add_fetch(&scheduler->idle_workers, 1, __ATOMIC_SEQ_CST);
+    if ( __atomic_load_n(&scheduler->queued_tasks, __ATOMIC_SEQ_CST) == 0 ){
+        if ( sleeping == 1 ){
+            deadline.tv_sec = (time_t)wake_time;
+            deadline.tv_nsec = (long)( ( wake_time - (double)deadline.tv_sec ) * 1000000000.0 );
+            pthread_cond_timedwait(&scheduler->work_available, &scheduler->mutex, &deadline);
+        }else{
+            pthread_cond_wait(&scheduler->work_available, &scheduler->mutex);
+        }
+    }
+    __atomic_sub_fetch(&scheduler->idle_workers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&scheduler->mutex);
+}
+
+/**
+ * Entry point of the worker threads.
+ *
+ * @param argument The reference to the worker.
+ *
+ * @return Nothing.
+ *
+ * @private
+ */
+void* worker_thread(void* argument){
+    worker_t* worker;
+    task_t* task;
+
+    worker = (worker_t*)argument;
+    while (1){
+        fire_timers(worker, get_scheduler_time());
+        task = find_task(worker);
+        if ( task != NULL ){
+            run_task(worker, task);
+        }else{
+            wait_for_work(worker);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Starts a scheduler running tasks on a fixed pool of worker threads.
+ *
+ * @param worker_count The amount of worker threads, if zero one worker per online core will be started.
+ *
+ * @return The reference to the scheduler.
+ */
+scheduler_t* start_scheduler(unsigned int worker_count){
+    pthread_condattr_t attributes;
+    scheduler_t* scheduler;
+    worker_t* worker;
+    unsigned int i;
+
+    if ( worker_count == 0 ){
+        worker_count = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = worker_count > 0 ? worker_count : 1;
+    }
+    scheduler = (scheduler_t*)malloc(sizeof(scheduler_t));
+    if ( scheduler == NULL ){
+        printf("Cannot allocate the scheduler, aborting.\n");
+        exit(6);
+    }
+    scheduler->worker_count = worker_count;
+    scheduler->queued_tasks = scheduler->idle_workers = scheduler->next_worker = 0;
+    pthread_mutex_init(&scheduler->mutex, NULL);
+    /* Timers are computed on the monotonic clock, timed waits must use the same. */
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&scheduler->work_available, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_cond_init(&scheduler->task_finished, NULL);
+    scheduler->workers = (worker_t*)malloc(sizeof(worker_t) * worker_count);
+    if ( scheduler->workers == NULL ){
+        printf("Cannot allocate the scheduler, aborting.\n");
+        exit(6);
+    }
+    for ( i = 0 ; i < worker_count ; i++ ){
+        worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        worker->index = i;
+        pthread_mutex_init(&worker->deque.mutex, NULL);
+        pthread_mutex_init(&worker->timer_mutex, NULL);
+        worker->deque.head = worker->deque.count = 0;
+        worker->deque.capacity = 64;
+        worker->deque.tasks = (task_t**)malloc(sizeof(task_t*) * worker->deque.capacity);
+        worker->timer_count = 0;
+        worker->timer_capacity = 64;
+        worker->timers = (task_t**)malloc(sizeof(task_t*) * worker->timer_capacity);
+        if ( worker->deque.tasks == NULL || worker->timers == NULL ){
+            printf("Cannot allocate the scheduler, aborting.\n");
+            exit(6);
+        }
+    }
+    /* Start the workers once all of them are ready as they steal from each other. */
+    for ( i = 0 ; i < worker_count ; i++ ){
+        scheduler->workers[i].thread = start_thread(worker_thread, &scheduler->workers[i], WORKER_STACK_SIZE);
+    }
+    return scheduler;
+}
+
+/**
+ * Prepares a task before submitting it for the first time, tasks are spread among the workers.
+ *
+ * @param scheduler The reference to the scheduler.
+ * @param task The reference to the task.
+ * @param routine The function that will be called each time the task runs.
+ * @param argument The argument that will be passed to the routine.
+ */
+void init_task(scheduler_t* scheduler, task_t* task, long (*routine)(void*), void* argument){
+    task->routine = routine;
+    task->argument = argument;
+    task->state = TASK_STATE_IDLE;
+    task->wake_time = 0;
+    task->timer_worker = task->timer_index = 0;
+    task->home_worker = __atomic_fetch_add(&scheduler->next_worker, 1, __ATOMIC_RELAXED) % scheduler->worker_count;
+}
+
+/**
+ * Asks the scheduler to run a task, submitting a task that is already queued has no effect while a sleeping task is taken
+ * out of the timer heap and run right away.
+ *
+ * @param scheduler The reference to the scheduler.
+ * @param task The reference to the task.
+ */
+void submit_task(scheduler_t* scheduler, task_t* task){
+    unsigned int state;
+    worker_t* worker;
+
+    state = __atomic_load_n(&task->state, __ATOMIC_ACQUIRE);
+    while (1){
+        if ( state == TASK_STATE_IDLE ){
+            if ( __atomic_compare_exchange_n(&task->state, &state, TASK_STATE_QUEUED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ){
+                enqueue_task(&scheduler->workers[task->home_worker], task);
+                return;
+            }
+        }else if ( state == TASK_STATE_RUNNING ){
+            /* Let the worker running the task know that it must run it again. */
+            if ( __atomic_compare_exchange_n(&task->state, &state, TASK_STATE_NOTIFIED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ){
+                return;
+            }
+        }else if ( state == TASK_STATE_SLEEPING ){
+            /* Tasks only leave the heap with its mutex held, so the task is still in there if it is still sleeping. */
+            worker = &scheduler->workers[task->timer_worker];
+            pthread_mutex_lock(&worker->timer_mutex);
+            if ( __atomic_compare_exchange_n(&task->state, &state, TASK_STATE_QUEUED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ){
+                remove_timer(worker, task->timer_index);
+                enqueue_task(worker, task);
+                pthread_mutex_unlock(&worker->timer_mutex);
+                return;
+            }
+            pthread_mutex_unlock(&worker->timer_mutex);
+        }else{
+            return;
+        }
+    }
+}
+
+/**
+ * Waits for the given task to complete.
+ *
+ * @param scheduler The reference to the scheduler.
+ * @param task The reference to the task.
+ */
+void wait_for_task(scheduler_t* scheduler, task_t* task){
+    pthread_mutex_lock(&scheduler->mutex);
+    while ( __atomic_load_n(&task->state, __ATOMIC_ACQUIRE) != TASK_STATE_FINISHED ){
+        pthread_cond_wait(&scheduler->task_finished, &scheduler->mutex);
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+}
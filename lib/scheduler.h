@@ -0,0 +1,11 @@
+#ifndef PROCHESS_SCHEDULER_H
+#define PROCHESS_SCHEDULER_H
+
+#include "types.h"
+
+void init_task(scheduler_t* scheduler, task_t* task, long (*routine)(void*), void* argument);
+void wait_for_task(scheduler_t* scheduler, task_t* task);
+scheduler_t* start_scheduler(unsigned int worker_count);
+void submit_task(scheduler_t* scheduler, task_t* task);
+
+#endif
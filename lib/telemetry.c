@@ -0,0 +1,134 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+#include "communicator.h"
+#include "types.h"
+
+/**
+ * Returns the bucket a value is counted in.
+ *
+ * @param value The value, in nanoseconds.
+ *
+ * @return The index of the bucket.
+ *
+ * @private
+ */
+unsigned int compute_histogram_bucket(unsigned long value){
+    unsigned int magnitude, bucket;
+
+    if ( value < ( 1UL << HISTOGRAM_SUB_BUCKET_BITS ) ){
+        return (unsigned int)value;
+    }
+    /* The position of the highest bit gives the power of two, the bits following it give the bucket within it. */
+    magnitude = 63 - (unsigned int)__builtin_clzl(value);
+    bucket = ( magnitude - HISTOGRAM_SUB_BUCKET_BITS + 1 ) << HISTOGRAM_SUB_BUCKET_BITS;
+    bucket += (unsigned int)( value >> ( magnitude - HISTOGRAM_SUB_BUCKET_BITS ) ) & ( ( 1U << HISTOGRAM_SUB_BUCKET_BITS ) - 1 );
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Returns the highest value counted in the given bucket.
+ *
+ * @param bucket The index of the bucket.
+ *
+ * @return The value, in nanoseconds.
+ *
+ * @private
+ */
+unsigned long get_histogram_bucket_limit(unsigned int bucket){
+    unsigned int magnitude;
+
+    if ( bucket < ( 1U << HISTOGRAM_SUB_BUCKET_BITS ) ){
+        return bucket;
+    }
+    magnitude = ( bucket >> HISTOGRAM_SUB_BUCKET_BITS ) + HISTOGRAM_SUB_BUCKET_BITS - 1;
+    return ( ( (unsigned long)( bucket & ( ( 1U << HISTOGRAM_SUB_BUCKET_BITS ) - 1 ) ) + ( 1UL << HISTOGRAM_SUB_BUCKET_BITS ) + 1 ) << ( magnitude - HISTOGRAM_SUB_BUCKET_BITS ) ) - 1;
+}
+
+/**
+ * Returns the current value of the clock moves are measured with, it is called through the TELEMETRY_CLOCK macro.
+ *
+ * @return The current time in nanoseconds.
+ */
+unsigned long read_telemetry_clock(){
+    return get_monotonic_nanoseconds();
+}
+
+/**
+ * Counts a value in the given histogram, any process or thread may record values at the same time.
+ *
+ * @param histogram The reference to the histogram.
+ * @param value The value, in nanoseconds.
+ */
+void record_histogram_value(histogram_t* histogram, unsigned long value){
+    unsigned long max;
+
+    __atomic_add_fetch(&histogram->buckets[compute_histogram_bucket(value)], 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while ( value > max && !__atomic_compare_exchange_n(&histogram->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+}
+
+/**
+ * Returns the amount of values counted in the given histogram.
+ *
+ * @param histogram The reference to the histogram.
+ *
+ * @return The amount of values.
+ */
+unsigned long get_histogram_count(histogram_t* histogram){
+    unsigned long count;
+    unsigned int i;
+
+    count = 0;
+    for ( i = 0 ; i < HISTOGRAM_BUCKETS ; i++ ){
+        count += histogram->buckets[i];
+    }
+    return count;
+}
+
+/**
+ * Returns the value below which the given percentage of the values counted in the histogram falls, it is at most 12.5% larger
+ * than the exact one and never larger than the highest value recorded.
+ *
+ * @param histogram The reference to the histogram.
+ * @param percentile The percentage, between 0 and 100.
+ *
+ * @return The value, in nanoseconds, or 0 if the histogram is empty.
+ */
+unsigned long get_histogram_percentile(histogram_t* histogram, double percentile){
+    unsigned long count, target, seen, limit;
+    unsigned int i;
+
+    count = get_histogram_count(histogram);
+    if ( count == 0 ){
+        return 0;
+    }
+    target = (unsigned long)( (double)count * percentile / 100.0 + 0.5 );
+    target = target < 1 ? 1 : ( target > count ? count : target );
+    seen = 0;
+    for ( i = 0 ; i < HISTOGRAM_BUCKETS ; i++ ){
+        seen += histogram->buckets[i];
+        if ( seen >= target ){
+            break;
+        }
+    }
+    limit = get_histogram_bucket_limit(i < HISTOGRAM_BUCKETS ? i : HISTOGRAM_BUCKETS - 1);
+    return histogram->max > 0 && histogram->max < limit ? histogram->max : limit;
+}
+
+/**
+ * Stores in a histogram the values counted in another one since a copy of it was taken, the highest value is the one of the whole histogram.
+ *
+ * @param result The reference to the histogram the difference will be stored in.
+ * @param current The reference to the histogram.
+ * @param previous The reference to the copy taken earlier.
+ */
+void subtract_histogram(histogram_t* result, histogram_t* current, histogram_t* previous){
+    unsigned int i;
+
+    for ( i = 0 ; i < HISTOGRAM_BUCKETS ; i++ ){
+        result->buckets[i] = current->buckets[i] - previous->buckets[i];
+    }
+    result->max = current->max;
+}
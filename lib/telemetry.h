@@ -0,0 +1,26 @@
+#ifndef PROCHESS_TELEMETRY_H
+#define PROCHESS_TELEMETRY_H
+
+#include "types.h"
+
+/**
+ * Measure what pawns do at each move: the clock is read into the given variable, durations are recorded in a histogram of the
+ * board telemetry and counters are incremented. Without SO_TELEMETRY nothing is measured and the compiler drops them all.
+ */
+#ifdef SO_TELEMETRY
+#define TELEMETRY_CLOCK(instant) ( (instant) = read_telemetry_clock() )
+#define TELEMETRY_RECORD(histogram, start, end) record_histogram_value(&(histogram), (end) - (start))
+#define TELEMETRY_COUNT(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_RELAXED)
+#else
+#define TELEMETRY_CLOCK(instant) ( (instant) = 0 )
+#define TELEMETRY_RECORD(histogram, start, end) ( (void)(start), (void)(end) )
+#define TELEMETRY_COUNT(counter) ( (void)0 )
+#endif
+
+void subtract_histogram(histogram_t* result, histogram_t* current, histogram_t* previous);
+unsigned long get_histogram_percentile(histogram_t* histogram, double percentile);
+void record_histogram_value(histogram_t* histogram, unsigned long value);
+unsigned long get_histogram_count(histogram_t* histogram);
+unsigned long read_telemetry_clock();
+
+#endif
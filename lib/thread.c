@@ -0,0 +1,58 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "thread.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+/**
+ * Starts a new thread running the given routine, signals are blocked in the new thread so that they are always handled by the master one.
+ *
+ * @param routine The function the thread will run.
+ * @param argument The argument that will be passed to the routine.
+ * @param stack_size The size of the thread stack in bytes, if zero the system default will be used.
+ *
+ * @return The handle of the thread started.
+ */
+pthread_t start_thread(void* (*routine)(void*), void* argument, size_t stack_size){
+    sigset_t blocked_signals, previous_signals;
+    pthread_attr_t attributes;
+    pthread_t thread;
+    int result;
+
+    pthread_attr_init(&attributes);
+    if ( stack_size > 0 ){
+        pthread_attr_setstacksize(&attributes, stack_size);
+    }
+    /* The new thread inherits the signal mask, block everything while creating it. */
+    sigfillset(&blocked_signals);
+    pthread_sigmask(SIG_BLOCK, &blocked_signals, &previous_signals);
+    result = pthread_create(&thread, &attributes, routine, argument);
+    pthread_sigmask(SIG_SETMASK, &previous_signals, NULL);
+    pthread_attr_destroy(&attributes);
+    if ( result != 0 ){
+        printf("Cannot start thread, aborting.\n");
+        printf("Reported error: %s.\n", strerror(result));
+        exit(3);
+    }
+    return thread;
+}
+
+/**
+ * Waits for the given thread to terminate.
+ *
+ * @param thread The handle of the thread to wait for.
+ */
+void join_thread(pthread_t thread){
+    int result;
+
+    result = pthread_join(thread, NULL);
+    if ( result != 0 ){
+        printf("Cannot join thread, aborting.\n");
+        printf("Reported error: %s.\n", strerror(result));
+        exit(5);
+    }
+}
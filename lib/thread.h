@@ -0,0 +1,9 @@
+#ifndef PROCHESS_THREAD_H
+#define PROCHESS_THREAD_H
+
+#include <pthread.h>
+
+pthread_t start_thread(void* (*routine)(void*), void* argument, size_t stack_size);
+void join_thread(pthread_t thread);
+
+#endif
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+
+#include "tracer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "types.h"
+
+/**
+ * The directory trace buffers are created in, spans are only recorded when the code is built with SO_TRACE.
+ */
+#ifdef SO_TRACE
+#define TRACE_DIRECTORY SO_TRACE
+#else
+#define TRACE_DIRECTORY "."
+#endif
+
+/**
+ * The trace buffer current process writes to, it is created at the first span.
+ */
+trace_buffer_t trace_buffer;
+
+/**
+ * Guards the creation of the trace buffer, as the threads of a process may record their first span at the same time.
+ */
+pthread_mutex_t trace_buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Set once the function letting go of the trace buffer after a fork has been registered, forked processes inherit it.
+ */
+boolean trace_fork_handler_registered = 0;
+
+/**
+ * The names spans are exported with, in the order of the TRACE_SPAN_* constants.
+ */
+const char* trace_span_names[TRACE_SPAN_COUNT] = { "receive", "handle", "placement", "planning", "wait", "move", "hold" };
+
+/**
+ * Returns the size of a trace buffer file.
+ *
+ * @return The size in bytes.
+ *
+ * @private
+ */
+size_t compute_trace_buffer_size(){
+    return sizeof(trace_header_t) + sizeof(trace_record_t) * TRACE_RING_RECORDS;
+}
+
+/**
+ * Lets go of the trace buffer inherited from the parent process, so that the forked process creates its own at its first span.
+ *
+ * @private
+ */
+void forget_trace_buffer(){
+    if ( trace_buffer.header != NULL ){
+        munmap(trace_buffer.header, compute_trace_buffer_size());
+        close(trace_buffer.fd);
+        trace_buffer.header = NULL;
+        trace_buffer.records = NULL;
+    }
+}
+
+/**
+ * Creates the trace buffer of current process and maps it in memory, the file is sized for TRACE_RING_RECORDS spans but only the
+ * pages that get written take memory.
+ *
+ * @private
+ */
+void open_trace_buffer(){
+    trace_header_t* header;
+    char path[4096];
+    void* segment;
+    int fd;
+
+    pthread_mutex_lock(&trace_buffer_mutex);
+    if ( __atomic_load_n(&trace_buffer.header, __ATOMIC_ACQUIRE) != NULL ){
+        /* Another thread got here first. */
+        pthread_mutex_unlock(&trace_buffer_mutex);
+        return;
+    }
+    if ( mkdir(TRACE_DIRECTORY, 0755) == -1 && errno != EEXIST ){
+        printf("Cannot create the trace directory %s, aborting.\n", TRACE_DIRECTORY);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    sprintf(path, "%.4000s/prochess-%d.trace", TRACE_DIRECTORY, (int)getpid());
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd == -1 || ftruncate(fd, (off_t)compute_trace_buffer_size()) != 0 ){
+        printf("Cannot create the trace buffer %s, aborting.\n", path);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    segment = mmap(NULL, compute_trace_buffer_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ( segment == MAP_FAILED ){
+        printf("Cannot map the trace buffer %s, aborting.\n", path);
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    if ( trace_fork_handler_registered == 0 ){
+        pthread_atfork(NULL, NULL, forget_trace_buffer);
+        trace_fork_handler_registered = 1;
+    }
+    header = (trace_header_t*)segment;
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+    header->version = TRACE_VERSION;
+    header->record_size = sizeof(trace_record_t);
+    header->pid = (int)getpid();
+    header->capacity = TRACE_RING_RECORDS;
+    trace_buffer.fd = fd;
+    trace_buffer.records = (trace_record_t*)( (char*)segment + sizeof(trace_header_t) );
+    /* Published last, threads that find it set use the records right away. */
+    __atomic_store_n(&trace_buffer.header, header, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&trace_buffer_mutex);
+}
+
+/**
+ * Returns the current value of the monotonic clock, spans are measured with it.
+ *
+ * @return The current time in nanoseconds.
+ */
+unsigned long read_trace_clock(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)now.tv_sec * 1000000000UL + (unsigned long)now.tv_nsec;
+}
+
+/**
+ * Records a span ending now in the trace buffer of current process, threads of the same process may record spans concurrently.
+ * It is called through the TRACE_END macro, which does nothing unless the code is built with SO_TRACE.
+ *
+ * @param span The type of the span (TRACE_SPAN_*).
+ * @param track The track the span belongs to (TRACE_TRACK_*).
+ * @param start The instant the span started at, as returned by "read_trace_clock".
+ */
+void record_trace_span(unsigned int span, unsigned int track, unsigned long start){
+    trace_record_t* record;
+    unsigned long end, index;
+
+    end = read_trace_clock();
+    if ( __atomic_load_n(&trace_buffer.header, __ATOMIC_ACQUIRE) == NULL ){
+        open_trace_buffer();
+    }
+    index = __atomic_fetch_add(&trace_buffer.header->head, 1, __ATOMIC_RELAXED) & ( TRACE_RING_RECORDS - 1 );
+    record = &trace_buffer.records[index];
+    /* Spans longer than about four seconds are clamped, only waits between rounds last that long. */
+    record->duration = end - start < 0xffffffffUL ? (unsigned int)( end - start ) : 0xffffffffU;
+    record->track = track;
+    record->span = span;
+    __atomic_store_n(&record->start, start, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the name of the given type of span.
+ *
+ * @param span The type of the span (TRACE_SPAN_*).
+ *
+ * @return The name of the span.
+ */
+const char* get_trace_span_name(unsigned int span){
+    return span < TRACE_SPAN_COUNT ? trace_span_names[span] : "unknown";
+}
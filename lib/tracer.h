@@ -0,0 +1,22 @@
+#ifndef PROCHESS_TRACER_H
+#define PROCHESS_TRACER_H
+
+#include "types.h"
+
+/**
+ * Marks the beginning and the end of a span: the start is stored in the given variable, the span is recorded at its end along with
+ * its type (TRACE_SPAN_*) and track (TRACE_TRACK_*). Without SO_TRACE nothing is measured and the compiler drops both.
+ */
+#ifdef SO_TRACE
+#define TRACE_BEGIN(start) ( (start) = read_trace_clock() )
+#define TRACE_END(span, track, start) record_trace_span((span), (track), (start))
+#else
+#define TRACE_BEGIN(start) ( (start) = 0 )
+#define TRACE_END(span, track, start) ( (void)(start) )
+#endif
+
+void record_trace_span(unsigned int span, unsigned int track, unsigned long start);
+const char* get_trace_span_name(unsigned int span);
+unsigned long read_trace_clock();
+
+#endif
@@ -3,7 +3,7 @@
 
 #include <stdlib.h>
 #include <sys/types.h>
-#include <semaphore.h>
+#include <pthread.h>
 
 /**
  * I just miss booleans.
@@ -20,15 +20,559 @@ typedef struct {
 } coords_t;
 
 /**
- * Represents a single cell in the game board.
+ * Represents the state of a pseudo random number generator, each pawn owns one so that no state is ever shared.
  */
 typedef struct {
+    unsigned int state[4];
+} random_t;
+
+/**
+ * Represents a single cell in the game board packed in a word that can be updated atomically: the occupant type
+ * (0 = empty, 1 = flag, 2 = pawn) takes the lowest 2 bits, the player pseudo name the next 8 and the flag score the rest.
+ */
+typedef unsigned int cell_t;
+
+/**
+ * Returns the occupant type stored in a cell.
+ */
+#define CELL_OCCUPANT_TYPE(cell) ( (unsigned short)( (cell) & 0x3 ) )
+
+/**
+ * Returns the pseudo name of the player owning a cell.
+ */
+#define CELL_PLAYER_PSEUDO_NAME(cell) ( (char)( ( (cell) >> 2 ) & 0xff ) )
+
+/**
+ * Returns the score of the flag placed on a cell.
+ */
+#define CELL_FLAG_SCORE(cell) ( (unsigned int)( (cell) >> 10 ) )
+
+/**
+ * Packs the given attributes into a cell.
+ */
+#define MAKE_CELL(occupant_type, player_pseudo_name, flag_score) ( (cell_t)(occupant_type) | ( (cell_t)(unsigned char)(player_pseudo_name) << 2 ) | ( (cell_t)(flag_score) << 10 ) )
+
+/**
+ * The bits holding the occupant type and the player pseudo name of a cell.
+ */
+#define CELL_OCCUPANT_MASK 0x3ff
+
+/**
+ * The destination cell is occupied by another pawn, the pawn did not move.
+ */
+#define MOVE_BLOCKED 0
+
+/**
+ * The pawn has moved to the destination cell.
+ */
+#define MOVE_DONE 1
+
+/**
+ * The pawn has moved to the destination cell and captured the flag placed there.
+ */
+#define MOVE_CAPTURED 2
+
+/**
+ * The amount of slots available in a message ring, it must be a power of two.
+ */
+#define MESSAGE_RING_CAPACITY 1024
+
+/**
+ * Players and pawns talk to the master process using its SysV message queue.
+ */
+#define TRANSPORT_MESSAGE_QUEUE 0
+
+/**
+ * Players and pawns talk to the master process using the ring buffer stored in the game board.
+ */
+#define TRANSPORT_MESSAGE_RING 1
+
+/**
+ * The maximum number of players a game can host, each player is named after a capital letter.
+ */
+#define MAX_PLAYERS 26
+
+/**
+ * The maximum number of flags that can be placed on the game board during a round.
+ */
+#define MAX_FLAGS 256
+
+/**
+ * A word of a bitboard, each bitboard keeps one bit per cell following the same indexing used for the cells.
+ */
+typedef unsigned long bitboard_word_t;
+
+/**
+ * The amount of cells covered by a single bitboard word.
+ */
+#define BITBOARD_WORD_BITS ( sizeof(bitboard_word_t) * 8 )
+
+/**
+ * The distance stored in the distance map for the cells no uncaptured flag can be reached from.
+ */
+#define DISTANCE_UNREACHABLE ( (unsigned int)~0U )
+
+/**
+ * The target given to the pawns that must hold their position for the whole round.
+ */
+#define PAWN_TARGET_NONE ( (unsigned int)~0U )
+
+/**
+ * The target given to the pawns that must walk to the nearest uncaptured flag following the distance map.
+ */
+#define PAWN_TARGET_NEAREST ( (unsigned int)~1U )
+
+/**
+ * The position stored for the pawns that have not been placed yet.
+ */
+#define PAWN_POSITION_UNKNOWN ( (unsigned int)~0U )
+
+/**
+ * The amount of words of the bitmap marking the flags that have been captured, one bit per flag in the flag index.
+ */
+#define FLAG_BITMAP_WORDS ( ( MAX_FLAGS + BITBOARD_WORD_BITS - 1 ) / BITBOARD_WORD_BITS )
+
+/**
+ * The bitboard marking cells having an occupant (a flag or a pawn).
+ */
+#define BITBOARD_OCCUPIED 0
+
+/**
+ * The amount of bitboards stored after the cells of a game board, scores and flags are read from the flag index instead.
+ */
+#define BITBOARD_COUNT 1
+
+/**
+ * Players place their pawns one at a time, passing a token through the master process after each pawn.
+ */
+#define PLACEMENT_TURNS 0
+
+/**
+ * The master process draws every pawn position up front, in turns, then all the players place their pawns at once.
+ */
+#define PLACEMENT_BATCH 1
+
+/**
+ * Players and pawns run as processes, the game board lives in a shared memory segment.
+ */
+#define EXECUTION_MODE_PROCESS 0
+
+/**
+ * Players and pawns run as threads of the master process, the game board lives in the heap.
+ */
+#define EXECUTION_MODE_THREAD 1
+
+/**
+ * Players run as threads while pawns run as tasks on a fixed pool of worker threads, the game board lives in the heap.
+ */
+#define EXECUTION_MODE_TASK 2
+
+/**
+ * Cells are stored column by column, the index of a cell is "x * height + y".
+ */
+#define BOARD_LAYOUT_COLUMNS 0
+
+/**
+ * Cells are stored in square tiles, tiles are stored row by row and so are the cells of a tile: neighbours in both directions
+ * are close in memory. The board is padded to a whole amount of tiles, padding cells are never free and have no neighbours.
+ */
+#define BOARD_LAYOUT_TILES 1
+
+/**
+ * Cells are indexed like in tiled boards but only the tiles holding something are stored: each tile is a chunk taken from a pool
+ * the first time one of its cells is written. Sparse boards have no free cell set, no distance map and no neighbour table, so the
+ * memory they take grows with the cells visited by pawns and flags rather than with the size of the board.
+ */
+#define BOARD_LAYOUT_SPARSE 2
+
+/**
+ * The base 2 logarithm of the side of a tile, tiles of 8x8 cells take 4 cache lines.
+ */
+#define BOARD_TILE_BITS 3
+
+/**
+ * The amount of cells stored in a chunk of a sparse board, a chunk holds a whole tile.
+ */
+#define BOARD_CHUNK_CELLS ( 1 << ( BOARD_TILE_BITS * 2 ) )
+
+/**
+ * The amount of words each bitboard takes in a chunk of a sparse board.
+ */
+#define BOARD_CHUNK_WORDS ( ( BOARD_CHUNK_CELLS + BITBOARD_WORD_BITS - 1 ) / BITBOARD_WORD_BITS )
+
+/**
+ * The amount of times a lock shared by the processes of the game is tried before sleeping on it.
+ */
+#define LOCK_SPIN_ATTEMPTS 100
+
+/**
+ * Stored in the chunk directory of a sparse board while a chunk is being taken from the pool.
+ */
+#define BOARD_CHUNK_PENDING ( (unsigned int)~0U )
+
+/**
+ * Stored in the chunk directory of a sparse board in place of BOARD_CHUNK_PENDING once processes sleep waiting for the chunk.
+ */
+#define BOARD_CHUNK_CONTENDED ( (unsigned int)~1U )
+
+/**
+ * The amount of pawn slots of a sparse board, dense boards have one for each cell.
+ */
+#define BOARD_SPARSE_PAWN_SLOTS 65536
+
+/**
+ * The amount of cells drawn at random looking for a free one on a sparse board before giving up as if the board was full.
+ */
+#define BOARD_SPARSE_FREE_CELL_DRAWS 1024
+
+/**
+ * The board segment is a System V shared memory segment, it must be removed by hand if the game does not end cleanly.
+ */
+#define BOARD_ALLOCATOR_SYSV 0
+
+/**
+ * The board segment is an anonymous shared memory file mapped with "mmap" (memfd_create, or shm_open followed by shm_unlink),
+ * processes forked afterwards inherit the mapping and the memory is released along with the last process using it.
+ */
+#define BOARD_ALLOCATOR_MMAP 1
+
+/**
+ * The board segment uses regular pages.
+ */
+#define HUGE_PAGES_NONE 0
+
+/**
+ * The board segment is rounded up to whole huge pages and the kernel is advised to back it with transparent huge pages.
+ */
+#define HUGE_PAGES_ADVISE 1
+
+/**
+ * The board segment is backed by huge pages reserved by the administrator (vm.nr_hugepages), regular pages are used if none is left.
+ */
+#define HUGE_PAGES_RESERVED 2
+
+/**
+ * The size of a huge page, the board segment is rounded up to a multiple of it whenever huge pages are requested.
+ */
+#define HUGE_PAGE_SIZE 2097152
+
+/**
+ * Pawns are driven step by step by the simulator on a virtual clock, the game board lives in the heap and nobody listens to the master queue.
+ */
+#define EXECUTION_MODE_SIMULATION 3
+
+/**
+ * The largest buffer a board renderer allocates, frames of larger boards are written out in more than one piece.
+ */
+#define RENDERER_MAX_BUFFER 4194304
+
+/**
+ * The record reserved by a process that died before writing it, readers skip it.
+ */
+#define EVENT_NONE 0
+
+/**
+ * The game has started: "from" and "to" hold the width and the height of the board, "slot" the amount of pawns and "value" the seed.
+ */
+#define EVENT_GAME_START 1
+
+/**
+ * A pawn has entered the board at position "to".
+ */
+#define EVENT_PLACEMENT 2
+
+/**
+ * A pawn has moved from position "from" to position "to".
+ */
+#define EVENT_MOVE 3
+
+/**
+ * A pawn has captured the flag at position "to", it follows the move that got the pawn there.
+ */
+#define EVENT_CAPTURE 4
+
+/**
+ * A flag worth "value" points has been placed at position "to".
+ */
+#define EVENT_FLAG 5
+
+/**
+ * Round "slot" has been released with "value" flags on the board.
+ */
+#define EVENT_ROUND_START 6
+
+/**
+ * Round "slot" has ended after "from" moves and "value" microseconds, the flags left are removed from the board.
+ */
+#define EVENT_ROUND_END 7
+
+/**
+ * The first bytes of every event log file.
+ */
+#define EVENT_LOG_MAGIC "PCEVENTS"
+
+/**
+ * The version of the layout of event log files, it changes whenever the header or the records change.
+ */
+#define EVENT_LOG_VERSION 1
+
+/**
+ * The amount of records an event log file can hold, files are sparse so that only the records written take space.
+ */
+#define EVENT_LOG_MAX_RECORDS 2097152
+
+/**
+ * The first bytes of every trace buffer file.
+ */
+#define TRACE_MAGIC "PCTRACES"
+
+/**
+ * The version of the layout of trace buffer files.
+ */
+#define TRACE_VERSION 1
+
+/**
+ * The amount of spans a trace buffer holds, it must be a power of two: once full the oldest spans are overwritten.
+ */
+#define TRACE_RING_RECORDS 262144
+
+/**
+ * A wait for a message: the master process waiting for players and pawns, or a player waiting for the master process.
+ */
+#define TRACE_SPAN_RECEIVE 0
+
+/**
+ * The master process handling a message.
+ */
+#define TRACE_SPAN_HANDLE 1
+
+/**
+ * A player placing its pawns, or a pawn placing itself.
+ */
+#define TRACE_SPAN_PLACEMENT 2
+
+/**
+ * A player sending its pawns to the flags.
+ */
+#define TRACE_SPAN_PLANNING 3
+
+/**
+ * A pawn waiting for a round to be released or for a message from its player.
+ */
+#define TRACE_SPAN_WAIT 4
+
+/**
+ * A pawn claiming its next cell and releasing the one it leaves.
+ */
+#define TRACE_SPAN_MOVE 5
+
+/**
+ * A pawn holding its position between two moves.
+ */
+#define TRACE_SPAN_HOLD 6
+
+/**
+ * The amount of span types.
+ */
+#define TRACE_SPAN_COUNT 7
+
+/**
+ * The track the spans of the master process are drawn on.
+ */
+#define TRACE_TRACK_MASTER 0
+
+/**
+ * The track the spans of a player are drawn on, given the number of the player counting from zero.
+ */
+#define TRACE_TRACK_PLAYER(number) ( 1 + (unsigned int)(number) )
+
+/**
+ * The track the spans of a pawn are drawn on, given its slot.
+ */
+#define TRACE_TRACK_PAWN(slot) ( 1 + MAX_PLAYERS + (unsigned int)(slot) )
+
+/**
+ * Each power of two covered by a histogram is split into 2^HISTOGRAM_SUB_BUCKET_BITS buckets, so that a value is known within 12.5%.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 3
+
+/**
+ * The amount of buckets of a histogram, enough for values up to 2^40 nanoseconds (about 18 minutes); larger ones fall in the last bucket.
+ */
+#define HISTOGRAM_BUCKETS 312
+
+/**
+ * Returned by a task routine when the task has nothing to do until it is submitted again.
+ */
+#define TASK_PARK -1
+
+/**
+ * Returned by a task routine when the task has completed and must never run again.
+ */
+#define TASK_DONE -2
+
+/**
+ * Represents a message.
+ */
+typedef struct {
+    unsigned short message_type;
     char player_pseudo_name;
-    unsigned int flag_score;
-    unsigned short occupant_type;
-    pid_t occupant_pid;
-    sem_t mutex;
-} cell_t;
+    char payload[128];
+} message_t;
+
+/**
+ * Represents a single slot of a message ring, the sequence number tells whether the slot is ready to be read or written.
+ */
+typedef struct {
+    unsigned int sequence;
+    message_t message;
+} message_slot_t;
+
+/**
+ * Represents a multi-producer/single-consumer message ring living in shared memory.
+ */
+typedef struct {
+    unsigned int head;
+    unsigned int tail;
+    unsigned int consumer_sleeping;
+    unsigned int waiting_producers;
+    unsigned int space_generation;
+    message_slot_t slots[MESSAGE_RING_CAPACITY];
+} message_ring_t;
+
+/**
+ * Represents a message queue used by threads living in the same process.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    unsigned int head;
+    unsigned int count;
+    unsigned int capacity;
+    message_t* messages;
+    void (*on_message)(void*);
+    void* on_message_argument;
+} mailbox_t;
+
+/**
+ * Represents a resumable unit of work run by the scheduler, the routine returns the nanoseconds to wait before running it again
+ * (0 to run it again right away), TASK_PARK or TASK_DONE.
+ */
+typedef struct {
+    long (*routine)(void*);
+    void* argument;
+    unsigned int state;
+    unsigned int home_worker;
+    double wake_time;
+    unsigned int timer_worker;
+    unsigned int timer_index;
+} task_t;
+
+/**
+ * Represents a double-ended queue of tasks, its owner works at the bottom while other workers steal from the top.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    task_t** tasks;
+    unsigned int head;
+    unsigned int count;
+    unsigned int capacity;
+} task_deque_t;
+
+/**
+ * Represents a worker thread of the scheduler along with the tasks it owns, the timer heap is guarded by its own mutex as
+ * sleeping tasks may be taken out of it when they are submitted.
+ */
+typedef struct {
+    struct scheduler_s* scheduler;
+    unsigned int index;
+    pthread_t thread;
+    task_deque_t deque;
+    pthread_mutex_t timer_mutex;
+    task_t** timers;
+    unsigned int timer_count;
+    unsigned int timer_capacity;
+} worker_t;
+
+/**
+ * Represents a pool of worker threads running tasks, one worker per core.
+ */
+typedef struct scheduler_s {
+    worker_t* workers;
+    unsigned int worker_count;
+    unsigned int queued_tasks;
+    unsigned int idle_workers;
+    unsigned int next_worker;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_available;
+    pthread_cond_t task_finished;
+} scheduler_t;
+
+/**
+ * A histogram of durations in nanoseconds, buckets grow along with the values they count like in HDR histograms: the values lower
+ * than 2^HISTOGRAM_SUB_BUCKET_BITS have a bucket each, then each power of two is split into the same amount of buckets.
+ */
+typedef struct {
+    unsigned long max;
+    unsigned long buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+/**
+ * Contains the figures recorded live during a game, it lives in the game board so that "prochess-stat" can read it while the game runs.
+ * Move latency, claim time and claim retries are only measured when the code is built with SO_TELEMETRY, as every pawn would write
+ * them at each move; moves are counted in the pawn slots instead.
+ */
+typedef struct {
+    histogram_t move_latency;
+    histogram_t claim_time;
+    histogram_t message_round_trip;
+    histogram_t capture_time;
+    unsigned long claim_retries;
+    unsigned int rounds;
+    boolean moves_measured;
+} telemetry_t;
+
+/**
+ * Represents a flag placed on the game board along with the player that has conquered it (0 until it is conquered).
+ */
+typedef struct {
+    unsigned int index;
+    unsigned int score;
+    char owner;
+} flag_t;
+
+/**
+ * Represents what the game board knows about a pawn: the cell it stands on, published by the pawn, and the cell of the flag
+ * it has been sent to, written by its player at the beginning of each round. The sequence is odd while the pawn is changing
+ * the cells of the board, only the pawn writes it so that snapshots can be taken without the pawn ever taking a lock. The
+ * message queue lets "prochess-stat" tell how many messages are waiting for the pawn, it is -1 until the pawn is spawned; the
+ * moves done and the ones blocked by another pawn are counted by the pawn itself for the same reason.
+ */
+typedef struct {
+    unsigned int position;
+    unsigned int target;
+    unsigned int sequence;
+    int mq_id;
+    unsigned int moves;
+    unsigned int blocked_moves;
+} pawn_slot_t;
+
+/**
+ * Represents the cells next to a given one, as indexes: only the first ones are valid, their amount is stored aside.
+ * Entries take 16 bytes so that 4 of them fit a cache line, the ones of the cells of a column (stored one after another) are contiguous.
+ */
+typedef struct {
+    unsigned int cells[4];
+} neighbours_t;
+
+/**
+ * Represents a chunk of a sparse board: the cells of a tile along with their bitboard words.
+ */
+typedef struct {
+    unsigned int number;
+    cell_t cells[BOARD_CHUNK_CELLS];
+    bitboard_word_t bitboards[BITBOARD_COUNT][BOARD_CHUNK_WORDS];
+} board_chunk_t;
 
 /**
  * Represents the whole game board.
@@ -36,13 +580,78 @@ typedef struct {
 typedef struct {
     int width;
     int height;
+    unsigned short layout;
+    unsigned int tile_columns;
+    unsigned int cell_count;
+    unsigned short allocator;
+    int segment_id;
+    size_t segment_size;
     int coordinator_mq_id;
+    unsigned short transport;
+    unsigned short execution_mode;
+    unsigned short placement;
+    unsigned long random_seed;
+    random_t generator;
+    message_ring_t coordinator_ring;
     long waiting_time;
     pid_t coordinator_pid;
     boolean round_in_progress;
+    unsigned int control_generation;
+    unsigned long round_release_time;
+    unsigned long round_start_latency_total;
+    unsigned long round_start_latency_max;
+    unsigned int round_started_pawns;
+    unsigned int used_moves[MAX_PLAYERS];
+    unsigned int flag_count;
+    flag_t flags[MAX_FLAGS];
+    unsigned int capture_generation;
+    bitboard_word_t captured_flags[FLAG_BITMAP_WORDS];
+    unsigned int sequence;
+    telemetry_t telemetry;
+    scheduler_t* scheduler;
+    unsigned int bitboard_words;
+    size_t bitboard_offset;
+    unsigned int free_cells_lock;
+    unsigned int free_cell_count;
+    size_t free_cells_offset;
+    unsigned int planned_positions;
+    unsigned int placement_plan_end;
+    size_t distance_maps_offset;
+    unsigned int active_distance_map;
+    unsigned int distance_map_sequences[2];
+    unsigned int pawn_slot_count;
+    size_t pawn_slots_offset;
+    size_t neighbours_offset;
+    size_t neighbour_counts_offset;
+    unsigned int chunk_count;
+    unsigned int materialized_chunks;
+    size_t chunk_directory_offset;
+    size_t chunk_pool_offset;
     cell_t cells[];
 } board_t;
 
+/**
+ * Contains everything a pawn needs to play, no matter if it runs as a process, as a thread or as a task.
+ */
+typedef struct {
+    board_t* game_board;
+    int mq_id;
+    char player_pseudo_name;
+    unsigned int max_moves;
+    coords_t position;
+    boolean assigned_position;
+    unsigned int slot;
+    unsigned int target;
+    unsigned int control_generation;
+    unsigned int capture_generation;
+    random_t generator;
+    unsigned int available_moves;
+    boolean playing;
+    boolean terminated;
+    unsigned long hold_end;
+    task_t task;
+} pawn_context_t;
+
 /**
  * Represents a single player's pawn.
  */
@@ -50,6 +659,8 @@ typedef struct {
     int owner_mq_id;
     int mq_id;
     pid_t pid;
+    pthread_t thread;
+    pawn_context_t* context;
 } pawn_t;
 
 /**
@@ -58,6 +669,7 @@ typedef struct {
 typedef struct {
     int mq_id;
     pid_t pid;
+    pthread_t thread;
     char pseudo_name;
     unsigned int available_moves;
     unsigned int total_moves;
@@ -66,12 +678,103 @@ typedef struct {
 } player_t;
 
 /**
- * Represents a message.
+ * Contains everything a player needs to play, no matter if it runs as a process or as a thread.
  */
 typedef struct {
-    unsigned short message_type;
+    board_t* game_board;
+    int mq_id;
+    char pseudo_name;
+    unsigned int number;
+    unsigned int player_count;
+    int pawn_count;
+    unsigned int max_pawn_moves;
+} player_context_t;
+
+/**
+ * Draws the game board: frames are built in a buffer and written out at once. A live renderer keeps the board in place at the
+ * top of the terminal and, once the first frame has been drawn, only draws the cells that have changed since the last one.
+ */
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    boolean live;
+    boolean drawn;
+    unsigned int width;
+    unsigned int height;
+    cell_t* drawn_cells;
+} renderer_t;
+
+/**
+ * The header of an event log file. Records follow it and are reserved by incrementing "length", so the records written by a
+ * process that crashed can still be read; "dropped" counts the events that did not fit in the file.
+ */
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int record_size;
+    int pid;
+    unsigned int dropped;
+    unsigned long length;
+} event_log_header_t;
+
+/**
+ * A record of an event log, 32 bytes long. The timestamp comes from the monotonic clock, in nanoseconds, so that the files
+ * written by the processes of a game can be merged; positions are stored as "y * width + x" whatever the board layout is.
+ */
+typedef struct {
+    unsigned long timestamp;
+    unsigned int slot;
+    unsigned int from;
+    unsigned int to;
+    unsigned int value;
+    unsigned char type;
     char player_pseudo_name;
-    char payload[128];
-} message_t;
+    char reserved[6];
+} event_record_t;
+
+/**
+ * The event log file a process writes to, mapped in its memory. The file is opened at the first event, so processes that
+ * record nothing leave no file behind.
+ */
+typedef struct {
+    const char* directory;
+    int fd;
+    event_log_header_t* header;
+    event_record_t* records;
+} event_log_t;
+
+/**
+ * The header of a trace buffer file, spans are stored in a ring right after it and "head" counts the spans ever recorded.
+ */
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int record_size;
+    int pid;
+    unsigned int capacity;
+    unsigned long head;
+} trace_header_t;
+
+/**
+ * A span recorded in a trace buffer: the instant it started at, from the monotonic clock, and how long it lasted, both in nanoseconds.
+ */
+typedef struct {
+    unsigned long start;
+    unsigned int duration;
+    unsigned int track;
+    unsigned int span;
+    unsigned int reserved;
+} trace_record_t;
+
+/**
+ * The trace buffer a process writes to, mapped in its memory.
+ */
+typedef struct {
+    int fd;
+    trace_header_t* header;
+    trace_record_t* records;
+} trace_buffer_t;
 
 #endif
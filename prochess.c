@@ -1,13 +1,18 @@
-#define _POSIX_SOURCE
+#define _POSIX_C_SOURCE 200112L
 
 #include <stdio.h>
 #include <signal.h>
 #include <time.h>
 #include <unistd.h>
+#include <string.h>
 
 #include "lib/board.h"
 #include "lib/communicator.h"
 #include "lib/player.h"
+#include "lib/recorder.h"
+#include "lib/renderer.h"
+#include "lib/telemetry.h"
+#include "lib/tracer.h"
 #include "lib/types.h"
 
 /* DEV */
@@ -52,13 +57,68 @@
 #define SO_MIN_HOLD_NSEC 100000000
 */
 
-unsigned int ready_players, current_placing_player, current_round, total_playing_time, conquered_flags, flag_count;
+/* Transport used by players and pawns to reach the master process (TRANSPORT_MESSAGE_QUEUE or TRANSPORT_MESSAGE_RING). */
+#ifndef SO_TRANSPORT
+#define SO_TRANSPORT TRANSPORT_MESSAGE_RING
+#endif
+
+/* How players place their pawns at startup (PLACEMENT_TURNS or PLACEMENT_BATCH). */
+#ifndef SO_PLACEMENT
+#define SO_PLACEMENT PLACEMENT_BATCH
+#endif
+
+/* Order the cells of the board are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE), tiles pay off on large boards and sparse boards on huge, mostly empty ones. */
+#ifndef SO_BOARD_LAYOUT
+#define SO_BOARD_LAYOUT BOARD_LAYOUT_COLUMNS
+#endif
+
+/* How the board segment shared with player and pawn processes is allocated (BOARD_ALLOCATOR_SYSV or BOARD_ALLOCATOR_MMAP). */
+#ifndef SO_BOARD_ALLOCATOR
+#define SO_BOARD_ALLOCATOR BOARD_ALLOCATOR_MMAP
+#endif
+
+/* Pages backing the board segment when allocated with mmap (HUGE_PAGES_NONE, HUGE_PAGES_ADVISE or HUGE_PAGES_RESERVED). */
+#ifndef SO_HUGE_PAGES
+#define SO_HUGE_PAGES HUGE_PAGES_ADVISE
+#endif
+
+/* Seed of the game, the same seed gives the same flags and the same pawn placement, zero picks a new seed at every run. */
+#ifndef SO_RANDOM_SEED
+#define SO_RANDOM_SEED 0
+#endif
+
+/* Execution mode used when none is given on the command line (EXECUTION_MODE_PROCESS, EXECUTION_MODE_THREAD or EXECUTION_MODE_TASK). */
+#ifndef SO_EXECUTION_MODE
+#define SO_EXECUTION_MODE EXECUTION_MODE_PROCESS
+#endif
+
+/* If set to "0" the master process never draws the board, "prochess-viewer" can draw it from another terminal. */
+#ifndef SO_DRAW_BOARD
+#define SO_DRAW_BOARD 1
+#endif
+
+/* If set to "1" the board stays at the top of the terminal and is redrawn after every capture, only the cells that have changed are drawn. */
+#ifndef SO_LIVE_BOARD
+#define SO_LIVE_BOARD 0
+#endif
+
+/* SO_EVENT_LOG is not defined here either: defined as the directory every process writes its event log to, "prochess-replay" merges and replays them. */
+
+/* SO_TRACE is not defined here: defined as a directory for every object (for instance through CFLAGS) it records where round time goes, "prochess-trace" exports it. */
+
+unsigned int ready_players, current_placing_player, current_round, total_playing_time, conquered_flags, total_conquered_flags, flag_count;
+double startup_time, round_start_instant, total_round_time, max_round_start_latency;
 player_t player_list[SO_NUM_G];
+unsigned long total_moves, request_time;
 time_t round_start_time;
-int game_board_shm_id;
+renderer_t* board_renderer;
 board_t* game_board;
 
 void signal_handler(int signo);
+void draw_board();
+void account_round_trip();
+double get_monotonic_time();
+void print_performance();
 void exec_round();
 void handle_message(message_t* message);
 void end_round();
@@ -66,29 +126,83 @@ void end_game();
 void kill_em_all();
 void start_over_again();
 
-int main() {
+int main(int argc, char** argv) {
+    unsigned long seed, trace_start;
+    unsigned short execution_mode;
     message_t message;
 
     printf("Starting up...\n");
-    current_round = total_playing_time = 0;
+    startup_time = get_monotonic_time();
+    current_round = total_playing_time = total_conquered_flags = 0;
+    total_moves = 0;
+    total_round_time = max_round_start_latency = 0;
+    /* The execution mode can be picked on the command line, "process", "thread" or "task". */
+    execution_mode = SO_EXECUTION_MODE;
+    if ( argc > 1 && strcmp(argv[1], "thread") == 0 ){
+        execution_mode = EXECUTION_MODE_THREAD;
+    }else if ( argc > 1 && strcmp(argv[1], "task") == 0 ){
+        execution_mode = EXECUTION_MODE_TASK;
+    }else if ( argc > 1 && strcmp(argv[1], "process") == 0 ){
+        execution_mode = EXECUTION_MODE_PROCESS;
+    }
     printf("Generating the game board...\n");
-    /* Generate, allocate and then attach the whole game board. */
-    game_board_shm_id = generate_board(SO_BASE, SO_ALTEZZA);
-    game_board = get_board(game_board_shm_id);
+    if ( execution_mode != EXECUTION_MODE_PROCESS ){
+        /* Players and pawns will be threads or tasks, the board can live in the heap. */
+        game_board = generate_local_board(SO_BASE, SO_ALTEZZA, execution_mode, SO_BOARD_LAYOUT);
+    }else{
+        /* Allocate the whole game board in shared memory, players and pawns inherit it when they are forked. */
+        game_board = generate_board(SO_BASE, SO_ALTEZZA, SO_BOARD_LAYOUT, SO_BOARD_ALLOCATOR, SO_HUGE_PAGES);
+    }
     game_board->waiting_time = SO_MIN_HOLD_NSEC;
-    printf("Generated a %dx%d board.\n", SO_BASE, SO_ALTEZZA);
+    game_board->transport = SO_TRANSPORT;
+    game_board->placement = SO_PLACEMENT;
+    seed = SO_RANDOM_SEED;
+    if ( seed == 0 ){
+        seed = (unsigned long)time(NULL) ^ ( (unsigned long)getpid() << 16 );
+    }
+    /* Must be seeded before players are spawned as every pawn derives its own stream from this seed. */
+    seed_board(game_board, seed);
+    printf("Generated a %dx%d board with seed %lu.\n", SO_BASE, SO_ALTEZZA, seed);
+#ifdef SO_EVENT_LOG
+    /* Started before players are spawned, each player and pawn process opens its own file. */
+    start_event_log(SO_EVENT_LOG);
+    record_event(EVENT_GAME_START, 0, SO_NUM_G * SO_NUM_P, SO_BASE, SO_ALTEZZA, (unsigned int)seed);
+    printf("Recording the game events in %s.\n", SO_EVENT_LOG);
+#endif
+#ifdef SO_TRACE
+    printf("Tracing every process in %s.\n", SO_TRACE);
+#endif
+    if ( execution_mode == EXECUTION_MODE_PROCESS ){
+        /* The viewer attaches the segment read only and takes its own snapshots, the game is never slowed down. */
+        if ( game_board->allocator == BOARD_ALLOCATOR_SYSV ){
+            printf("Watch the game with: ./prochess-viewer %d\n", game_board->segment_id);
+            printf("Watch its figures with: ./prochess-stat %d\n", game_board->segment_id);
+        }else{
+            printf("Watch the game with: ./prochess-viewer /proc/%d/fd/%d\n", (int)getpid(), game_board->segment_id);
+            printf("Watch its figures with: ./prochess-stat /proc/%d/fd/%d\n", (int)getpid(), game_board->segment_id);
+        }
+    }
     /* Setup the signal handler used to handle SIGALRM whenever a timer expire. */
     signal(SIGALRM, signal_handler);
-    printf("Spawning players...\n");
+    if ( execution_mode == EXECUTION_MODE_TASK ){
+        printf("Spawning players as threads and pawns as tasks...\n");
+    }else{
+        printf("Spawning players as %s...\n", execution_mode == EXECUTION_MODE_THREAD ? "threads" : "processes");
+    }
     /* Spawn the players' processes. */
-    spawn_players(player_list, game_board_shm_id, SO_NUM_G, SO_NUM_P, SO_N_MOVES);
+    spawn_players(player_list, game_board, SO_NUM_G, SO_NUM_P, SO_N_MOVES);
     if ( game_board->coordinator_pid == getpid() ){
         printf("Spawned %d players.\n", SO_NUM_G);
+        board_renderer = create_renderer(game_board, STDOUT_FILENO, SO_LIVE_BOARD);
         /* Start listening for incoming messages. */
         while (1){
             /* Pull a message from the message queue. */
-            message = receive_message(game_board->coordinator_mq_id);
+            TRACE_BEGIN(trace_start);
+            message = receive_coordinator_message(game_board);
+            TRACE_END(TRACE_SPAN_RECEIVE, TRACE_TRACK_MASTER, trace_start);
+            TRACE_BEGIN(trace_start);
             handle_message(&message);
+            TRACE_END(TRACE_SPAN_HANDLE, TRACE_TRACK_MASTER, trace_start);
         }
     }
     return 0;
@@ -100,64 +214,78 @@ int main() {
  * @param message The reference to the message to handle.
  */
 void handle_message(message_t* message){
-    unsigned int index;
-
     switch ( message->message_type ){
         case 1: {
             /* A player is ready to place his pawns. */
             ready_players++;
             if ( ready_players == SO_NUM_G ){
                 current_placing_player = ready_players = 0;
-                /* Signal players they can place their pawns (one for each player). */
-                allow_pawn_placing(&player_list[current_placing_player]);
+                request_time = get_monotonic_nanoseconds();
+                if ( game_board->placement == PLACEMENT_BATCH ){
+                    /* Draw every pawn position in turns, then let all the players place their pawns at once. */
+                    plan_pawn_placement(game_board, SO_NUM_G * SO_NUM_P);
+                    broadcast_signal_to_players(player_list, SO_NUM_G, 2);
+                }else{
+                    /* Signal players they can place their pawns (one for each player). */
+                    allow_pawn_placing(&player_list[current_placing_player]);
+                }
             }
         }break;
         case 3: {
             /* A player has placed a pawn. */
+            account_round_trip();
             current_placing_player++;
             if ( current_placing_player == SO_NUM_G ){
                 current_placing_player = 0;
             }
             /* Allow players to place another pawn. */
+            request_time = get_monotonic_nanoseconds();
             allow_pawn_placing(&player_list[current_placing_player]);
         }break;
         case 4: {
-            /* A player has placed all its pawns, as they are synchronized, other players did the same. */
-            exec_round();
+            /* A player has placed all its pawns, when placing in turns other players did the same, otherwise each one reports. */
+            account_round_trip();
+            if ( game_board->placement == PLACEMENT_TURNS || ++ready_players == SO_NUM_G ){
+                ready_players = 0;
+                exec_round();
+            }
         }break;
         case 6: {
             /* A player is ready to start playing the round. */
+            account_round_trip();
             ready_players++;
             if ( ready_players == SO_NUM_G ){
                 ready_players = 0;
                 round_start_time = time(NULL);
+                round_start_instant = get_monotonic_time();
                 /* Set the timer that will stop the game if flags are not all conquered. */
                 alarm(SO_MAX_TIME);
-                /* Signal the players the round has started. */
+                /* Release all the pawns at once, then signal the players the round has started. */
+                release_round(game_board);
+                record_event(EVENT_ROUND_START, 0, current_round, 0, 0, flag_count);
                 broadcast_signal_to_players(player_list, SO_NUM_G, 7);
             }
         }break;
         case 9:{
             /* A pawn has conquered a flag. */
             printf("Flag conquered by %c!\n", message->player_pseudo_name);
-            /* Propagate the event to other players. */
-            broadcast_signal_to_players(player_list, SO_NUM_G, 9);
             conquered_flags++;
-            if ( conquered_flags == flag_count ){
+            total_conquered_flags++;
+            if ( conquered_flags < flag_count ){
+                /* Pawns heading to the flag just conquered turn to the nearest one left. */
+                update_distance_map(game_board);
+                if ( SO_LIVE_BOARD == 1 ){
+                    draw_board();
+                }
+            }else{
                 printf("Every flag has been conquered, ending current round.\n");
                 /* Start a new round. */
                 end_round();
-                print_status(game_board, player_list, SO_NUM_G);
+                draw_board();
+                print_stats(game_board, player_list, SO_NUM_G);
                 start_over_again();
             }
         }break;
-        case 10:{
-            /* A pawn has moved, update moves counter. */
-            index = get_player_index(player_list, SO_NUM_G, message->player_pseudo_name);
-            if ( index != -1 ){
-                player_list[index].available_moves--;
-            }
-        }break;
     }
 }
 
@@ -165,20 +293,42 @@ void handle_message(message_t* message){
  * Execute a new round.
  */
 void exec_round(){
+    if ( current_round == 0 ){
+        /* Every pawn has been placed, startup is over. */
+        startup_time = get_monotonic_time() - startup_time;
+        printf("Startup completed in %.3f seconds.\n", startup_time);
+    }
     printf("Starting a new round!\n");
     conquered_flags = 0;
     current_round++;
-    game_board->round_in_progress = 1;
     /* Spawn a random number of flags on the game board. */
     flag_count = spawn_flags(game_board, SO_FLAG_MIN, SO_FLAG_MAX, SO_ROUND_SCORE);
     printf("Spawned %d flags.\n", flag_count);
+    record_flags(game_board);
     /* Print out a graphic representation of the game board. */
-    print_board(game_board);
+    draw_board();
     printf("Game start!\n");
     /* Warn the players a new round is about to start. */
+    request_time = get_monotonic_nanoseconds();
     broadcast_signal_to_players(player_list, SO_NUM_G, 5);
 }
 
+/**
+ * Accounts the time elapsed between the last request sent to the players and the answer just received.
+ */
+void account_round_trip(){
+    record_histogram_value(&game_board->telemetry.message_round_trip, get_monotonic_nanoseconds() - request_time);
+}
+
+/**
+ * Draws the game board, unless drawing has been left to the viewer.
+ */
+void draw_board(){
+    if ( SO_DRAW_BOARD == 1 ){
+        render_board(board_renderer, game_board);
+    }
+}
+
 /**
  * Handles the "SIGALRM" signal.
  *
@@ -195,10 +345,27 @@ void signal_handler(int signo){
  * Ends current round.
  */
 void end_round(){
-    game_board->round_in_progress = 0;
+    double average_latency, max_latency;
+    unsigned int round_moves;
+
+    /* Pawns stop moving within the hold time they are sleeping in. */
+    close_round(game_board);
     /* Update the score counter for each player. */
     update_players_score(game_board, player_list, SO_NUM_G, 1);
+    /* Read the moves counters pawns have incremented, each move used to cost a message to the master process. */
+    round_moves = update_players_moves(game_board, player_list, SO_NUM_G);
+    printf("Moves done this round: %d (movement messages eliminated).\n", round_moves);
+    if ( game_board->round_started_pawns > 0 ){
+        /* Time elapsed between the round release and the first move of each pawn. */
+        average_latency = (double)game_board->round_start_latency_total / (double)game_board->round_started_pawns / 1000.0;
+        max_latency = (double)game_board->round_start_latency_max / 1000.0;
+        max_round_start_latency = max_latency > max_round_start_latency ? max_latency : max_round_start_latency;
+        printf("Round start latency: %.1f us average, %.1f us max over %d pawns.\n", average_latency, max_latency, game_board->round_started_pawns);
+    }
     total_playing_time += time(NULL) - round_start_time;
+    record_event(EVENT_ROUND_END, 0, current_round, round_moves, 0, (unsigned int)( ( get_monotonic_time() - round_start_instant ) * 1000000.0 ));
+    total_round_time += get_monotonic_time() - round_start_instant;
+    total_moves += round_moves;
     /* Stop the game timer. */
     alarm(0);
 }
@@ -213,8 +380,13 @@ void end_game(){
     kill_em_all();
     printf("GAME OVER (time out)!\n");
     /* Print out the game board representation, players stats and game metrics. */
-    print_status(game_board, player_list, SO_NUM_G);
+    draw_board();
+    print_stats(game_board, player_list, SO_NUM_G);
     print_metrics(player_list, SO_NUM_G, current_round, total_playing_time);
+    print_performance();
+    destroy_renderer(board_renderer);
+    /* Players and pawns are gone, so every event log is complete. */
+    stop_event_log();
     printf("Deallocating resources and ending the game.\n");
     /* Deallocate all the resources. */
     destroy_board(game_board);
@@ -230,6 +402,8 @@ void kill_em_all(){
 
     /* Inform the player processes that they must terminate. */
     broadcast_signal_to_players(player_list, SO_NUM_G, 11);
+    /* Players must be gone before their message queues are released. */
+    wait_for_players(game_board, player_list, SO_NUM_G);
     for ( i = 0 ; i < SO_NUM_G ; i++ ){
         /* Remove the message queues associated to the players. */
         close_message_queue(player_list[i].mq_id);
@@ -240,13 +414,8 @@ void kill_em_all(){
  * Start a new round.
  */
 void start_over_again(){
-    unsigned int i, moves;
-
-    moves = SO_NUM_P * SO_N_MOVES;
     /* Restore the moves count for each player. */
-    for ( i = 0 ; i < SO_NUM_G ; i++ ){
-        player_list[i].available_moves = moves;
-    }
+    reset_players_moves(game_board, player_list, SO_NUM_G);
     /* Remove old flags from the game board. */
     remove_flags(game_board);
     /* Inform the players a new round is about to start. */
@@ -254,3 +423,30 @@ void start_over_again(){
     /* Start a new round. */
     exec_round();
 }
+
+/**
+ * Returns the current value of the monotonic clock.
+ *
+ * @return A floating point number representing the current time in seconds.
+ */
+double get_monotonic_time(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Prints out the figures used to compare the execution modes.
+ */
+void print_performance(){
+    printf("Performance: \n");
+    printf("\tStartup time: %.3f seconds.\n", startup_time);
+    if ( total_round_time > 0 ){
+        printf("\tMoves/sec: %.1f.\n", (double)total_moves / total_round_time);
+    }
+    if ( total_conquered_flags > 0 ){
+        printf("\tMoves per capture: %.1f.\n", (double)total_moves / (double)total_conquered_flags);
+    }
+    printf("\tWorst round start latency: %.1f us.\n", max_round_start_latency);
+}
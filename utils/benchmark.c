@@ -0,0 +1,724 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "../lib/board.h"
+#include "../lib/communicator.h"
+#include "../lib/pawn.h"
+#include "../lib/random.h"
+#include "../lib/renderer.h"
+#include "../lib/thread.h"
+#include "../lib/types.h"
+
+/**
+ * Represents a cell as it was stored before cells were packed into a single word, used as a baseline.
+ */
+typedef struct {
+    char player_pseudo_name;
+    unsigned int flag_score;
+    unsigned short occupant_type;
+    pid_t occupant_pid;
+    sem_t mutex;
+} legacy_cell_t;
+
+/**
+ * Contains the state of a thread moving a pawn during the moves benchmark.
+ */
+typedef struct {
+    board_t* game_board;
+    legacy_cell_t* legacy_cells;
+    boolean legacy;
+    char player_pseudo_name;
+    unsigned int seed;
+    double duration;
+    unsigned long moves;
+    pthread_t thread;
+} mover_t;
+
+/**
+ * Contains the state of a thread playing pawns during the play benchmark.
+ */
+typedef struct {
+    pawn_context_t* pawns;
+    unsigned int pawn_count;
+    double duration;
+    unsigned long moves;
+    pthread_t thread;
+} playing_thread_t;
+
+/**
+ * Returns the current value of the monotonic clock in seconds.
+ *
+ * @return A floating point number representing the current time.
+ *
+ * @private
+ */
+double get_current_time(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Allocates an anonymous memory region that will be shared with the child processes.
+ *
+ * @param size The size of the region in bytes.
+ *
+ * @return A pointer to the allocated region.
+ *
+ * @private
+ */
+void* allocate_shared_region(size_t size){
+    void* region;
+
+    region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if ( region == MAP_FAILED ){
+        printf("Cannot allocate the shared region, aborting.\n");
+        printf("Reported error: %s.\n", strerror(errno));
+        exit(1);
+    }
+    return region;
+}
+
+/**
+ * Forks the producer processes, each of them sends the given amount of messages using the given transport.
+ *
+ * @param transport The transport to use (TRANSPORT_MESSAGE_QUEUE or TRANSPORT_MESSAGE_RING).
+ * @param mq_id The message queue the producers will send their messages to.
+ * @param ring The ring buffer the producers will send their messages to.
+ * @param producers The amount of producer processes to fork.
+ * @param messages The amount of messages each producer will send.
+ *
+ * @private
+ */
+void spawn_producers(unsigned short transport, int mq_id, message_ring_t* ring, unsigned int producers, unsigned int messages){
+    unsigned int i, j;
+    message_t message;
+    pid_t pid;
+
+    /* Flush pending output so that it won't be duplicated by the child processes. */
+    fflush(stdout);
+    for ( i = 0 ; i < producers ; i++ ){
+        pid = fork();
+        if ( pid == -1 ){
+            printf("Cannot fork process, aborting.\n");
+            exit(3);
+        }else if ( pid == 0 ){
+            message.message_type = 10;
+            message.player_pseudo_name = (char)( i + 65 );
+            message.payload[0] = 0;
+            for ( j = 0 ; j < messages ; j++ ){
+                if ( transport == TRANSPORT_MESSAGE_RING ){
+                    ring_send_message(ring, &message);
+                }else{
+                    send_message(mq_id, &message);
+                }
+            }
+            exit(0);
+        }
+    }
+}
+
+/**
+ * Measures how many messages per second the master process can pull using the given transport.
+ *
+ * @param transport The transport to measure (TRANSPORT_MESSAGE_QUEUE or TRANSPORT_MESSAGE_RING).
+ * @param producers The amount of producer processes to fork.
+ * @param messages The amount of messages each producer will send.
+ *
+ * @return The measured throughput in messages per second.
+ *
+ * @private
+ */
+double measure_transport(unsigned short transport, unsigned int producers, unsigned int messages){
+    double start_time, elapsed_time;
+    unsigned long total, i;
+    message_ring_t* ring;
+    int mq_id;
+
+    total = (unsigned long)producers * messages;
+    mq_id = -1;
+    ring = NULL;
+    if ( transport == TRANSPORT_MESSAGE_RING ){
+        ring = (message_ring_t*)allocate_shared_region(sizeof(message_ring_t));
+        init_message_ring(ring);
+    }else{
+        mq_id = generate_message_queue();
+    }
+    start_time = get_current_time();
+    spawn_producers(transport, mq_id, ring, producers, messages);
+    for ( i = 0 ; i < total ; i++ ){
+        if ( transport == TRANSPORT_MESSAGE_RING ){
+            ring_receive_message(ring);
+        }else{
+            receive_message(mq_id);
+        }
+    }
+    elapsed_time = get_current_time() - start_time;
+    while ( wait(NULL) > 0 ){}
+    if ( transport == TRANSPORT_MESSAGE_RING ){
+        munmap(ring, sizeof(message_ring_t));
+    }else{
+        close_message_queue(mq_id);
+    }
+    return (double)total / elapsed_time;
+}
+
+/**
+ * Compares the throughput of the SysV message queue against the shared memory ring buffer.
+ *
+ * @param argc The amount of arguments passed to the sub-command.
+ * @param argv The arguments passed to the sub-command: the amount of producers and the amount of messages each one sends.
+ *
+ * @private
+ */
+void benchmark_transport(int argc, char** argv){
+    unsigned int producers, messages;
+
+    producers = argc > 0 ? (unsigned int)atoi(argv[0]) : 4;
+    messages = argc > 1 ? (unsigned int)atoi(argv[1]) : 100000;
+    printf("Transport benchmark: %u producers, %u messages each.\n", producers, messages);
+    printf("\tSysV message queue: %.0f messages/sec.\n", measure_transport(TRANSPORT_MESSAGE_QUEUE, producers, messages));
+    printf("\tShared memory ring: %.0f messages/sec.\n", measure_transport(TRANSPORT_MESSAGE_RING, producers, messages));
+}
+
+/**
+ * Moves a pawn using one semaphore per cell the way it was done before cells were packed: check, release, then place.
+ *
+ * @param cells The reference to the legacy cells.
+ * @param old_index The index of the cell the pawn is leaving.
+ * @param new_index The index of the cell the pawn is moving to.
+ * @param player_pseudo_name The pseudo name of the player owning the pawn.
+ *
+ * @return If the pawn has been moved will be returned "1".
+ *
+ * @private
+ */
+boolean legacy_move_pawn(legacy_cell_t* cells, unsigned int old_index, unsigned int new_index, char player_pseudo_name){
+    boolean is_allowed;
+
+    sem_wait(&cells[new_index].mutex);
+    is_allowed = cells[new_index].occupant_type <= 1 ? 1 : 0;
+    sem_post(&cells[new_index].mutex);
+    if ( is_allowed == 1 ){
+        sem_wait(&cells[old_index].mutex);
+        cells[old_index].occupant_type = 0;
+        cells[old_index].player_pseudo_name = 0;
+        sem_post(&cells[old_index].mutex);
+        sem_wait(&cells[new_index].mutex);
+        if ( cells[new_index].occupant_type <= 1 ){
+            cells[new_index].occupant_type = 2;
+            cells[new_index].player_pseudo_name = player_pseudo_name;
+        }
+        sem_post(&cells[new_index].mutex);
+    }
+    return is_allowed;
+}
+
+/**
+ * Entry point of the threads moving a pawn back and forth as fast as possible.
+ *
+ * @param argument The reference to the mover state.
+ *
+ * @return Nothing.
+ *
+ * @private
+ */
+void* mover_thread(void* argument){
+    coords_t position, next_position;
+    board_t* game_board;
+    double end_time;
+    boolean moved;
+    mover_t* mover;
+
+    mover = (mover_t*)argument;
+    game_board = mover->game_board;
+    /* Every thread gets a distinct starting cell. */
+    position.x = ( mover->player_pseudo_name - 65 ) % game_board->width;
+    position.y = ( mover->player_pseudo_name - 65 ) / game_board->width;
+    position.index = compute_index(game_board, &position);
+    place_pawn(game_board, &position, mover->player_pseudo_name, mover->player_pseudo_name - 65);
+    end_time = get_current_time() + mover->duration;
+    while ( ( mover->moves & 1023 ) != 0 || get_current_time() < end_time ){
+        /* Step to a random neighbour, wrapping around the edges. */
+        next_position = position;
+        if ( rand_r(&mover->seed) & 1 ){
+            next_position.x = ( position.x + 1 + ( rand_r(&mover->seed) & 1 ) * ( game_board->width - 2 ) ) % game_board->width;
+        }else{
+            next_position.y = ( position.y + 1 + ( rand_r(&mover->seed) & 1 ) * ( game_board->height - 2 ) ) % game_board->height;
+        }
+        next_position.index = compute_index(game_board, &next_position);
+        if ( mover->legacy == 1 ){
+            moved = legacy_move_pawn(mover->legacy_cells, position.index, next_position.index, mover->player_pseudo_name);
+        }else{
+            moved = move_pawn(game_board, &position, &next_position, mover->player_pseudo_name, mover->player_pseudo_name - 65) != MOVE_BLOCKED ? 1 : 0;
+        }
+        if ( moved == 1 ){
+            position = next_position;
+        }
+        mover->moves++;
+    }
+    return NULL;
+}
+
+/**
+ * Measures how many contended moves per second the given amount of threads can do on a small board.
+ *
+ * @param legacy If set to "1" cells will be guarded by semaphores, otherwise packed cells and compare-and-swap will be used.
+ * @param threads The amount of threads moving a pawn each.
+ * @param size The width and height of the board.
+ * @param duration The amount of seconds to run for.
+ *
+ * @return The measured throughput in moves per second.
+ *
+ * @private
+ */
+double measure_moves(boolean legacy, unsigned int threads, unsigned int size, double duration){
+    legacy_cell_t* legacy_cells;
+    double start_time, elapsed_time;
+    unsigned long total;
+    board_t* game_board;
+    mover_t* movers;
+    unsigned int i;
+
+    game_board = generate_local_board(size, size, EXECUTION_MODE_THREAD, BOARD_LAYOUT_COLUMNS);
+    legacy_cells = (legacy_cell_t*)calloc(size * size, sizeof(legacy_cell_t));
+    movers = (mover_t*)calloc(threads, sizeof(mover_t));
+    if ( legacy_cells == NULL || movers == NULL ){
+        printf("Cannot allocate the benchmark board, aborting.\n");
+        exit(1);
+    }
+    for ( i = 0 ; i < size * size ; i++ ){
+        sem_init(&legacy_cells[i].mutex, 0, 1);
+    }
+    for ( i = 0 ; i < threads ; i++ ){
+        movers[i].game_board = game_board;
+        movers[i].legacy_cells = legacy_cells;
+        movers[i].legacy = legacy;
+        movers[i].player_pseudo_name = (char)( i + 65 );
+        movers[i].seed = i + 1;
+        movers[i].duration = duration;
+        movers[i].moves = 0;
+    }
+    start_time = get_current_time();
+    for ( i = 0 ; i < threads ; i++ ){
+        movers[i].thread = start_thread(mover_thread, &movers[i], 0);
+    }
+    total = 0;
+    for ( i = 0 ; i < threads ; i++ ){
+        join_thread(movers[i].thread);
+        total += movers[i].moves;
+    }
+    elapsed_time = get_current_time() - start_time;
+    for ( i = 0 ; i < size * size ; i++ ){
+        sem_destroy(&legacy_cells[i].mutex);
+    }
+    free(movers);
+    free(legacy_cells);
+    free(game_board);
+    return (double)total / elapsed_time;
+}
+
+/**
+ * Compares contended moves per second using semaphore guarded cells against packed cells updated with compare-and-swap.
+ *
+ * @param argc The amount of arguments passed to the sub-command.
+ * @param argv The arguments passed to the sub-command: the amount of threads, the board side and the seconds to run for.
+ *
+ * @private
+ */
+void benchmark_moves(int argc, char** argv){
+    unsigned int threads, size;
+    double duration;
+
+    threads = argc > 0 ? (unsigned int)atoi(argv[0]) : 4;
+    size = argc > 1 ? (unsigned int)atoi(argv[1]) : 4;
+    duration = argc > 2 ? atof(argv[2]) : 1;
+    if ( threads > size * size || threads > MAX_PLAYERS ){
+        printf("Too many threads for a %ux%u board.\n", size, size);
+        exit(1);
+    }
+    printf("Moves benchmark: %u threads on a %ux%u board for %.1f seconds.\n", threads, size, size, duration);
+    printf("\tSemaphore per cell: %.0f moves/sec.\n", measure_moves(1, threads, size, duration));
+    printf("\tPacked cell with compare-and-swap: %.0f moves/sec.\n", measure_moves(0, threads, size, duration));
+}
+
+/**
+ * Entry point of the threads making their pawns play moves in turns as fast as possible, pawns join a new round once out of moves.
+ *
+ * @param argument The reference to the thread state.
+ *
+ * @return Nothing.
+ *
+ * @private
+ */
+void* playing_thread(void* argument){
+    playing_thread_t* state;
+    double end_time;
+    unsigned int i;
+
+    state = (playing_thread_t*)argument;
+    end_time = get_current_time() + state->duration;
+    while ( ( state->moves & 1023 ) != 0 || get_current_time() < end_time ){
+        for ( i = 0 ; i < state->pawn_count ; i++ ){
+            if ( step_simulated_pawn(&state->pawns[i]) == 0 ){
+                start_simulated_round(&state->pawns[i]);
+            }else{
+                state->moves++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Measures how many moves per second pawns do when played through "play_move", the way they play a round (holds left out).
+ *
+ * @param threads The amount of threads, each one plays its own pawns.
+ * @param pawns The amount of pawns each thread plays.
+ * @param size The width and height of the board.
+ * @param duration The amount of seconds to run for.
+ *
+ * @return The measured throughput in moves per second.
+ *
+ * @private
+ */
+double measure_play(unsigned int threads, unsigned int pawns, unsigned int size, double duration){
+    playing_thread_t* states;
+    double start_time, elapsed_time;
+    pawn_context_t* contexts;
+    unsigned long total;
+    board_t* game_board;
+    unsigned int i;
+
+    game_board = generate_local_board(size, size, EXECUTION_MODE_THREAD, BOARD_LAYOUT_COLUMNS);
+    contexts = (pawn_context_t*)calloc(threads * pawns, sizeof(pawn_context_t));
+    states = (playing_thread_t*)calloc(threads, sizeof(playing_thread_t));
+    if ( contexts == NULL || states == NULL ){
+        printf("Cannot allocate the benchmark board, aborting.\n");
+        exit(1);
+    }
+    /* No flag is placed, pawns step aside at random as they do once every flag has been captured; moves are still counted. */
+    game_board->round_in_progress = 1;
+    for ( i = 0 ; i < threads * pawns ; i++ ){
+        init_simulated_pawn(&contexts[i], game_board, (char)( i % MAX_PLAYERS + 65 ), 1000, NULL, i);
+        get_pawn_slots(game_board)[i].target = PAWN_TARGET_NEAREST;
+        start_simulated_round(&contexts[i]);
+    }
+    for ( i = 0 ; i < threads ; i++ ){
+        states[i].pawns = &contexts[i * pawns];
+        states[i].pawn_count = pawns;
+        states[i].duration = duration;
+        states[i].moves = 0;
+    }
+    start_time = get_current_time();
+    for ( i = 0 ; i < threads ; i++ ){
+        states[i].thread = start_thread(playing_thread, &states[i], 0);
+    }
+    total = 0;
+    for ( i = 0 ; i < threads ; i++ ){
+        join_thread(states[i].thread);
+        total += states[i].moves;
+    }
+    elapsed_time = get_current_time() - start_time;
+    free(states);
+    free(contexts);
+    free(game_board);
+    return (double)total / elapsed_time;
+}
+
+/**
+ * Measures moves per second through the whole move path of a pawn: planning the step on the distance map, claiming the cell and
+ * the accounting done afterwards. Build it with and without SO_TELEMETRY to tell what measuring moves costs.
+ *
+ * @param argc The amount of arguments passed to the sub-command.
+ * @param argv The arguments passed to the sub-command: the amount of threads, the pawns of each thread, the board side and the seconds to run for.
+ *
+ * @private
+ */
+void benchmark_play(int argc, char** argv){
+    unsigned int threads, pawns, size;
+    double duration;
+
+    threads = argc > 0 ? (unsigned int)atoi(argv[0]) : 4;
+    pawns = argc > 1 ? (unsigned int)atoi(argv[1]) : 16;
+    size = argc > 2 ? (unsigned int)atoi(argv[2]) : 16;
+    duration = argc > 3 ? atof(argv[3]) : 1;
+    if ( threads == 0 || pawns == 0 || threads * pawns > size * size / 2 ){
+        printf("Too many pawns for a %ux%u board.\n", size, size);
+        exit(1);
+    }
+#ifdef SO_TELEMETRY
+    printf("Play benchmark: %u threads playing %u pawns each on a %ux%u board for %.1f seconds, moves measured.\n", threads, pawns, size, size, duration);
+#else
+    printf("Play benchmark: %u threads playing %u pawns each on a %ux%u board for %.1f seconds, moves not measured.\n", threads, pawns, size, size, duration);
+#endif
+    printf("\tplay_move: %.0f moves/sec.\n", measure_play(threads, pawns, size, duration));
+}
+
+/**
+ * Measures how long whole board scans and pawn walks take with the given board layout.
+ * Scans visit the cells row by row as "print_board" does, walkers step to a random neighbour in turns as pawns do.
+ *
+ * @param layout The order cells are stored in (BOARD_LAYOUT_COLUMNS, BOARD_LAYOUT_TILES or BOARD_LAYOUT_SPARSE).
+ * @param size The width and height of the board.
+ * @param walkers The amount of pawns walking on the board.
+ * @param steps The amount of steps each walker does.
+ * @param scan_time The reference to the variable where the time taken by each cell visit, in nanoseconds, will be stored at.
+ * @param walk_time The reference to the variable where the time taken by each step, in nanoseconds, will be stored at.
+ *
+ * @private
+ */
+void measure_layout(unsigned short layout, unsigned int size, unsigned int walkers, unsigned int steps, double* scan_time, double* walk_time){
+    unsigned int i, j, x, y, count, passes, *positions;
+    neighbours_t neighbours;
+    unsigned long checksum;
+    board_t* game_board;
+    random_t generator;
+    double start_time;
+
+    game_board = generate_local_board(size, size, EXECUTION_MODE_THREAD, layout);
+    positions = (unsigned int*)malloc(sizeof(unsigned int) * walkers);
+    if ( positions == NULL ){
+        printf("Cannot allocate the walkers, aborting.\n");
+        exit(1);
+    }
+    seed_random(&generator, 1, 0);
+    for ( i = 0 ; i < walkers ; i++ ){
+        positions[i] = compute_index_from_params(game_board, random_below(&generator, size), random_below(&generator, size));
+        *get_cell(game_board, positions[i]) = MAKE_CELL(2, 65, 0);
+    }
+    checksum = 0;
+    passes = 10;
+    start_time = get_current_time();
+    for ( i = 0 ; i < passes ; i++ ){
+        for ( y = 0 ; y < size ; y++ ){
+            for ( x = 0 ; x < size ; x++ ){
+                checksum += CELL_OCCUPANT_TYPE(load_cell(game_board, compute_index_from_params(game_board, x, y)));
+            }
+        }
+    }
+    *scan_time = ( get_current_time() - start_time ) * 1000000000.0 / ( (double)passes * size * size );
+    start_time = get_current_time();
+    for ( j = 0 ; j < steps ; j++ ){
+        for ( i = 0 ; i < walkers ; i++ ){
+            /* Pick a neighbour, look at it as a pawn would and step there. */
+            count = get_cell_neighbours(game_board, positions[i], &neighbours);
+            positions[i] = neighbours.cells[random_below(&generator, count)];
+            checksum += CELL_OCCUPANT_TYPE(load_cell(game_board, positions[i]));
+        }
+    }
+    *walk_time = ( get_current_time() - start_time ) * 1000000000.0 / ( (double)walkers * steps );
+    if ( checksum == 0 ){
+        /* Keeps the compiler from dropping the loops, walkers are always found by the scans. */
+        printf("No walker found.\n");
+    }
+    free(positions);
+    free(game_board);
+}
+
+/**
+ * Compares whole board scans and pawn walks on a board stored column by column against one stored in tiles and a sparse one.
+ *
+ * @param argc The amount of arguments passed to the sub-command.
+ * @param argv The arguments passed to the sub-command: the board side, the amount of walkers and the steps each one does.
+ *
+ * @private
+ */
+void benchmark_layout(int argc, char** argv){
+    unsigned int size, walkers, steps;
+    double scan_time, walk_time;
+
+    size = argc > 0 ? (unsigned int)atoi(argv[0]) : 1000;
+    walkers = argc > 1 ? (unsigned int)atoi(argv[1]) : 10000;
+    steps = argc > 2 ? (unsigned int)atoi(argv[2]) : 1000;
+    if ( size == 0 || walkers == 0 ){
+        printf("The board must have a cell and a walker at least.\n");
+        exit(1);
+    }
+    printf("Layout benchmark: %u walkers doing %u steps each on a %ux%u board.\n", walkers, steps, size, size);
+    measure_layout(BOARD_LAYOUT_COLUMNS, size, walkers, steps, &scan_time, &walk_time);
+    printf("\tColumns: %.2f ns per scanned cell, %.2f ns per step.\n", scan_time, walk_time);
+    measure_layout(BOARD_LAYOUT_TILES, size, walkers, steps, &scan_time, &walk_time);
+    printf("\tTiles: %.2f ns per scanned cell, %.2f ns per step.\n", scan_time, walk_time);
+    measure_layout(BOARD_LAYOUT_SPARSE, size, walkers, steps, &scan_time, &walk_time);
+    printf("\tSparse: %.2f ns per scanned cell, %.2f ns per step.\n", scan_time, walk_time);
+}
+
+/**
+ * Prints the board one cell at a time as it was done before frames were built in a buffer, used as a baseline.
+ *
+ * @param output The stream to print to.
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void legacy_print_board(FILE* output, board_t* game_board){
+    unsigned int x, y;
+    cell_t cell;
+
+    fprintf(output, "\n    ");
+    for ( x = 1 ; x <= game_board->width ; x++ ){
+        fprintf(output, x < 10 ? "| 00%d" : ( x < 100 ? "| 0%d" : "| %d" ), x);
+    }
+    fprintf(output, "|\n    |");
+    for ( x = 1 ; x <= game_board->width ; x++ ){
+        fprintf(output, x == 1 ? "----" : "-----");
+    }
+    fprintf(output, "|\n");
+    for ( y = 0 ; y < game_board->height ; y++ ){
+        fprintf(output, y < 9 ? " 00%d" : ( y < 99 ? " 0%d" : " %d" ), y + 1);
+        for ( x = 0 ; x < game_board->width ; x++ ){
+            cell = load_cell(game_board, compute_index_from_params(game_board, x, y));
+            switch ( CELL_OCCUPANT_TYPE(cell) ){
+                case 0: {
+                    fprintf(output, "|    ");
+                }break;
+                case 1: {
+                    if ( CELL_PLAYER_PSEUDO_NAME(cell) > 0 ){
+                        fprintf(output, "|\033[1;34m♟\033[0m-\033[31m⚑%c\033[0m", CELL_PLAYER_PSEUDO_NAME(cell));
+                    }else{
+                        fprintf(output, "|  \033[34m⚑\033[0m ");
+                    }
+                }break;
+                case 2: {
+                    fprintf(output, "| \033[1;34m♟\033[0m%c ", CELL_PLAYER_PSEUDO_NAME(cell));
+                }break;
+            }
+        }
+        fprintf(output, "|\n    |");
+        for ( x = 0 ; x <= game_board->width ; x++ ){
+            fprintf(output, x == 0 ? "" : ( x == 2 ? "----" : "-----" ));
+        }
+        fprintf(output, "|\n");
+    }
+    fprintf(output, "\n");
+}
+
+/**
+ * Measures how long drawing a frame takes, between two frames some pawns step to a neighbour cell.
+ *
+ * @param mode The way frames are drawn: 0 for one print call per cell, 1 for whole frames built in a buffer and 2 for changed cells only.
+ * @param width The width of the board.
+ * @param height The height of the board.
+ * @param frames The amount of frames to draw.
+ *
+ * @return The time taken by each frame in microseconds.
+ *
+ * @private
+ */
+double measure_render(unsigned short mode, unsigned int width, unsigned int height, unsigned int frames){
+    unsigned int i, j, count, pawn_count, *positions;
+    coords_t old_position, new_position;
+    neighbours_t neighbours;
+    renderer_t* renderer;
+    board_t* game_board;
+    random_t generator;
+    double start_time, frame_time;
+    FILE* output;
+    int fd;
+
+    game_board = generate_local_board(width, height, EXECUTION_MODE_THREAD, BOARD_LAYOUT_COLUMNS);
+    /* Frames are thrown away, so only the cost of building and handing them over to the kernel is measured. */
+    fd = open("/dev/null", O_WRONLY);
+    output = fdopen(fd, "w");
+    pawn_count = width * height / 10;
+    positions = (unsigned int*)malloc(sizeof(unsigned int) * ( pawn_count + 1 ));
+    if ( fd == -1 || output == NULL || positions == NULL ){
+        printf("Cannot set up the render benchmark, aborting.\n");
+        exit(1);
+    }
+    /* A terminal makes stdout line buffered, so the baseline pays a write for every line. */
+    setvbuf(output, NULL, _IOLBF, BUFSIZ);
+    seed_board(game_board, 1);
+    clear_board(game_board);
+    spawn_flags(game_board, 5, 40, 200);
+    seed_random(&generator, 1, 0);
+    for ( i = 0 ; i < pawn_count ; i++ ){
+        do {
+            positions[i] = compute_index_from_params(game_board, random_below(&generator, width), random_below(&generator, height));
+            compute_coords(game_board, positions[i], &new_position);
+        } while ( place_pawn(game_board, &new_position, (char)( 65 + i % 4 ), i) == MOVE_BLOCKED );
+    }
+    renderer = create_renderer(game_board, fd, mode == 2 ? 1 : 0);
+    start_time = get_current_time();
+    for ( j = 0 ; j < frames ; j++ ){
+        /* About one pawn in a hundred moves between two frames. */
+        for ( i = 0 ; i < pawn_count / 100 + 1 ; i++ ){
+            count = get_cell_neighbours(game_board, positions[i], &neighbours);
+            compute_coords(game_board, positions[i], &old_position);
+            compute_coords(game_board, neighbours.cells[random_below(&generator, count)], &new_position);
+            if ( move_pawn(game_board, &old_position, &new_position, (char)( 65 + i % 4 ), i) != MOVE_BLOCKED ){
+                positions[i] = compute_index(game_board, &new_position);
+            }
+        }
+        if ( mode == 0 ){
+            legacy_print_board(output, game_board);
+        }else{
+            render_board(renderer, game_board);
+        }
+    }
+    fflush(output);
+    frame_time = ( get_current_time() - start_time ) * 1000000.0 / (double)frames;
+    destroy_renderer(renderer);
+    fclose(output);
+    free(positions);
+    free(game_board);
+    return frame_time;
+}
+
+/**
+ * Compares drawing the board one cell at a time against whole frames built in a buffer and against drawing changed cells only.
+ *
+ * @param argc The amount of arguments passed to the sub-command.
+ * @param argv The arguments passed to the sub-command: the width and the height of the board and the amount of frames.
+ *
+ * @private
+ */
+void benchmark_render(int argc, char** argv){
+    unsigned int width, height, frames;
+
+    width = argc > 0 ? (unsigned int)atoi(argv[0]) : 120;
+    height = argc > 1 ? (unsigned int)atoi(argv[1]) : 40;
+    frames = argc > 2 ? (unsigned int)atoi(argv[2]) : 1000;
+    if ( width == 0 || height == 0 || frames == 0 ){
+        printf("The board must have a cell and a frame at least.\n");
+        exit(1);
+    }
+    printf("Render benchmark: %u frames of a %ux%u board.\n", frames, width, height);
+    printf("\tPrint per cell: %.1f us per frame.\n", measure_render(0, width, height, frames));
+    printf("\tBuffered frame: %.1f us per frame.\n", measure_render(1, width, height, frames));
+    printf("\tChanged cells only: %.1f us per frame.\n", measure_render(2, width, height, frames));
+}
+
+int main(int argc, char** argv){
+    if ( argc > 1 && strcmp(argv[1], "transport") == 0 ){
+        benchmark_transport(argc - 2, argv + 2);
+    }else if ( argc > 1 && strcmp(argv[1], "moves") == 0 ){
+        benchmark_moves(argc - 2, argv + 2);
+    }else if ( argc > 1 && strcmp(argv[1], "play") == 0 ){
+        benchmark_play(argc - 2, argv + 2);
+    }else if ( argc > 1 && strcmp(argv[1], "layout") == 0 ){
+        benchmark_layout(argc - 2, argv + 2);
+    }else if ( argc > 1 && strcmp(argv[1], "render") == 0 ){
+        benchmark_render(argc - 2, argv + 2);
+    }else{
+        printf("Usage: %s transport [producers] [messages]\n", argv[0]);
+        printf("       %s moves [threads] [board side] [seconds]\n", argv[0]);
+        printf("       %s play [threads] [pawns per thread] [board side] [seconds]\n", argv[0]);
+        printf("       %s layout [board side] [walkers] [steps]\n", argv[0]);
+        printf("       %s render [width] [height] [frames]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
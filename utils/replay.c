@@ -0,0 +1,478 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../lib/board.h"
+#include "../lib/renderer.h"
+#include "../lib/types.h"
+
+/**
+ * Boards having more cells than this are replayed on a sparse board, so that only the cells pawns get to take memory.
+ */
+#define MAX_DENSE_REPLAY_CELLS 4194304
+
+/**
+ * An event read from a log file along with where it comes from, so that events recorded at the same instant keep a stable order.
+ */
+typedef struct {
+    event_record_t record;
+    unsigned int file;
+    unsigned long index;
+} loaded_event_t;
+
+/**
+ * Contains the state of the game being replayed.
+ */
+typedef struct {
+    board_t* game_board;
+    renderer_t* renderer;
+    unsigned int* occupants;
+    unsigned int* positions;
+    unsigned int pawn_count;
+    unsigned int scores[MAX_PLAYERS];
+    unsigned int games;
+    unsigned int rounds;
+    unsigned long moves;
+    unsigned int captures;
+    unsigned int out_of_order;
+    boolean draw;
+} replay_t;
+
+/**
+ * Returns the name of the given type of event.
+ *
+ * @param type The type of the event.
+ *
+ * @return The name of the type.
+ *
+ * @private
+ */
+const char* get_event_name(unsigned char type){
+    switch ( type ){
+        case EVENT_GAME_START: return "GAME_START";
+        case EVENT_PLACEMENT: return "PLACEMENT";
+        case EVENT_MOVE: return "MOVE";
+        case EVENT_CAPTURE: return "CAPTURE";
+        case EVENT_FLAG: return "FLAG";
+        case EVENT_ROUND_START: return "ROUND_START";
+        case EVENT_ROUND_END: return "ROUND_END";
+    }
+    return "UNKNOWN";
+}
+
+/**
+ * Compares two events by the time they have been recorded at, events recorded at the same time are kept in file order.
+ *
+ * @param a The reference to the first event.
+ * @param b The reference to the second event.
+ *
+ * @return A negative number if the first event comes first, a positive number if it comes after the second one.
+ *
+ * @private
+ */
+int compare_events(const void* a, const void* b){
+    const loaded_event_t *first, *second;
+
+    first = (const loaded_event_t*)a;
+    second = (const loaded_event_t*)b;
+    if ( first->record.timestamp != second->record.timestamp ){
+        return first->record.timestamp < second->record.timestamp ? -1 : 1;
+    }
+    if ( first->file != second->file ){
+        return first->file < second->file ? -1 : 1;
+    }
+    return first->index < second->index ? -1 : ( first->index > second->index ? 1 : 0 );
+}
+
+/**
+ * Reads the events of the given log files and sorts them by the time they have been recorded at, records reserved by a process
+ * that died before writing them are left out.
+ *
+ * @param paths The paths to the log files.
+ * @param file_count The amount of log files.
+ * @param length The reference to the variable where the amount of events read will be stored at.
+ * @param dropped The reference to the variable where the amount of events that didn't fit in the files will be stored at.
+ *
+ * @return The reference to the events read, it must be freed once done.
+ *
+ * @private
+ */
+loaded_event_t* load_events(char** paths, unsigned int file_count, unsigned long* length, unsigned long* dropped){
+    unsigned long i, count, capacity, available;
+    event_log_header_t header;
+    event_record_t record;
+    loaded_event_t* events;
+    unsigned int file;
+    FILE* stream;
+    long size;
+
+    events = NULL;
+    *length = *dropped = capacity = 0;
+    for ( file = 0 ; file < file_count ; file++ ){
+        stream = fopen(paths[file], "rb");
+        if ( stream == NULL || fread(&header, sizeof(event_log_header_t), 1, stream) != 1 || memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0 ){
+            printf("Cannot read the event log %s, aborting.\n", paths[file]);
+            exit(1);
+        }
+        if ( header.version != EVENT_LOG_VERSION || header.record_size != sizeof(event_record_t) ){
+            printf("The event log %s has been written by another version, aborting.\n", paths[file]);
+            exit(1);
+        }
+        /* A process killed before closing its log leaves the file at full size, the header tells how much of it has been used. */
+        fseek(stream, 0, SEEK_END);
+        size = ftell(stream);
+        fseek(stream, (long)sizeof(event_log_header_t), SEEK_SET);
+        available = ( (unsigned long)size - sizeof(event_log_header_t) ) / sizeof(event_record_t);
+        count = header.length < available ? header.length : available;
+        *dropped += header.dropped;
+        for ( i = 0 ; i < count ; i++ ){
+            if ( fread(&record, sizeof(event_record_t), 1, stream) != 1 ){
+                printf("Cannot read the event log %s, aborting.\n", paths[file]);
+                exit(1);
+            }
+            if ( record.type == EVENT_NONE ){
+                continue;
+            }
+            if ( *length == capacity ){
+                capacity = capacity == 0 ? 65536 : capacity * 2;
+                events = (loaded_event_t*)realloc(events, sizeof(loaded_event_t) * capacity);
+                if ( events == NULL ){
+                    printf("Cannot allocate the events, aborting.\n");
+                    exit(1);
+                }
+            }
+            events[*length].record = record;
+            events[*length].file = file;
+            events[*length].index = i;
+            (*length)++;
+        }
+        fclose(stream);
+    }
+    qsort(events, *length, sizeof(loaded_event_t), compare_events);
+    return events;
+}
+
+/**
+ * Merges the given log files into a single one holding every event in the order they have been recorded.
+ *
+ * @param output The path to the file to write.
+ * @param paths The paths to the log files.
+ * @param file_count The amount of log files.
+ *
+ * @private
+ */
+void merge_logs(const char* output, char** paths, unsigned int file_count){
+    unsigned long i, length, dropped;
+    event_log_header_t header;
+    loaded_event_t* events;
+    FILE* stream;
+
+    events = load_events(paths, file_count, &length, &dropped);
+    memset(&header, 0, sizeof(event_log_header_t));
+    memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.record_size = sizeof(event_record_t);
+    header.dropped = (unsigned int)dropped;
+    header.length = length;
+    stream = fopen(output, "wb");
+    if ( stream == NULL || fwrite(&header, sizeof(event_log_header_t), 1, stream) != 1 ){
+        printf("Cannot write the event log %s, aborting.\n", output);
+        exit(1);
+    }
+    for ( i = 0 ; i < length ; i++ ){
+        if ( fwrite(&events[i].record, sizeof(event_record_t), 1, stream) != 1 ){
+            printf("Cannot write the event log %s, aborting.\n", output);
+            exit(1);
+        }
+    }
+    fclose(stream);
+    printf("Merged %lu events from %u files into %s.\n", length, file_count, output);
+    if ( dropped > 0 ){
+        printf("Events that didn't fit in the logs: %lu.\n", dropped);
+    }
+    free(events);
+}
+
+/**
+ * Prints every event of the given log files, in the order they have been recorded.
+ *
+ * @param paths The paths to the log files.
+ * @param file_count The amount of log files.
+ *
+ * @private
+ */
+void dump_logs(char** paths, unsigned int file_count){
+    unsigned long i, length, dropped;
+    loaded_event_t* events;
+    event_record_t* record;
+
+    events = load_events(paths, file_count, &length, &dropped);
+    for ( i = 0 ; i < length ; i++ ){
+        record = &events[i].record;
+        printf("%12.6f %-11s %c slot: %u, from: %u, to: %u, value: %u.\n", (double)( record->timestamp - events[0].record.timestamp ) / 1000000000.0,
+            get_event_name(record->type), record->player_pseudo_name > 0 ? record->player_pseudo_name : '-', record->slot, record->from, record->to, record->value);
+    }
+    if ( dropped > 0 ){
+        printf("Events that didn't fit in the logs: %lu.\n", dropped);
+    }
+    free(events);
+}
+
+/**
+ * Prints the score each player has made since the game started.
+ *
+ * @param replay The reference to the replay.
+ * @param label The text preceding the scores.
+ *
+ * @private
+ */
+void print_replay_scores(replay_t* replay, const char* label){
+    unsigned int i;
+
+    printf("\t%s:", label);
+    for ( i = 0 ; i < MAX_PLAYERS ; i++ ){
+        if ( replay->scores[i] > 0 ){
+            printf(" %c: %u.", (char)( i + 65 ), replay->scores[i]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * Prepares the board for a new game, a new board is generated only when the size has changed.
+ *
+ * @param replay The reference to the replay.
+ * @param record The reference to the EVENT_GAME_START event.
+ *
+ * @private
+ */
+void start_replayed_game(replay_t* replay, event_record_t* record){
+    if ( replay->game_board == NULL || replay->game_board->width != record->from || replay->game_board->height != record->to ){
+        if ( replay->game_board != NULL ){
+            destroy_renderer(replay->renderer);
+            destroy_board(replay->game_board);
+            free(replay->occupants);
+        }
+        replay->game_board = generate_local_board(record->from, record->to, EXECUTION_MODE_SIMULATION, record->from * record->to > MAX_DENSE_REPLAY_CELLS ? BOARD_LAYOUT_SPARSE : BOARD_LAYOUT_COLUMNS);
+        replay->renderer = create_renderer(replay->game_board, STDOUT_FILENO, 0);
+        /* Slots are stored plus one, so that a zeroed array tells no cell is taken and its pages are never touched until needed. */
+        replay->occupants = (unsigned int*)calloc((size_t)record->from * record->to, sizeof(unsigned int));
+    }else{
+        clear_board(replay->game_board);
+        memset(replay->occupants, 0, sizeof(unsigned int) * replay->game_board->width * replay->game_board->height);
+    }
+    free(replay->positions);
+    replay->positions = (unsigned int*)malloc(sizeof(unsigned int) * ( record->slot > 0 ? record->slot : 1 ));
+    if ( replay->occupants == NULL || replay->positions == NULL ){
+        printf("Cannot allocate the replayed board, aborting.\n");
+        exit(1);
+    }
+    replay->pawn_count = record->slot;
+    memset(replay->positions, 0xff, sizeof(unsigned int) * ( record->slot > 0 ? record->slot : 1 ));
+    memset(replay->scores, 0, sizeof(replay->scores));
+    replay->game_board->flag_count = 0;
+    replay->games++;
+    printf("Game %u: %ux%u board, %u pawns, seed %u.\n", replay->games, record->from, record->to, record->slot, record->value);
+}
+
+/**
+ * Returns the cell at the given position of the replayed board.
+ *
+ * @param replay The reference to the replay.
+ * @param position The position of the cell, as recorded in the log.
+ *
+ * @return The reference to the cell.
+ *
+ * @private
+ */
+cell_t* get_replayed_cell(replay_t* replay, unsigned int position){
+    return get_cell(replay->game_board, compute_index_from_params(replay->game_board, position % replay->game_board->width, position / replay->game_board->width));
+}
+
+/**
+ * Puts a pawn on the given cell, whoever the log says was there is replaced: events recorded by different processes at nearly
+ * the same time may be read in the wrong order, a pawn may enter a cell just before the move of the pawn leaving it.
+ *
+ * @param replay The reference to the replay.
+ * @param record The reference to the EVENT_PLACEMENT or EVENT_MOVE event.
+ *
+ * @private
+ */
+void replay_pawn_move(replay_t* replay, event_record_t* record){
+    cell_t* cell;
+
+    if ( record->slot >= replay->pawn_count ){
+        replay->out_of_order++;
+        return;
+    }
+    if ( record->type == EVENT_MOVE ){
+        if ( replay->positions[record->slot] != record->from ){
+            replay->out_of_order++;
+        }
+        if ( replay->occupants[record->from] == record->slot + 1 ){
+            /* Only released if no other pawn has entered it already. */
+            replay->occupants[record->from] = 0;
+            *get_replayed_cell(replay, record->from) = 0;
+        }
+    }
+    if ( replay->occupants[record->to] != 0 && replay->occupants[record->to] != record->slot + 1 ){
+        replay->out_of_order++;
+    }
+    replay->occupants[record->to] = record->slot + 1;
+    replay->positions[record->slot] = record->to;
+    cell = get_replayed_cell(replay, record->to);
+    *cell = MAKE_CELL(2, record->player_pseudo_name, CELL_FLAG_SCORE(*cell));
+}
+
+/**
+ * Accounts the capture of a flag, the score of the flag is the one recorded when it has been spawned.
+ *
+ * @param replay The reference to the replay.
+ * @param record The reference to the EVENT_CAPTURE event.
+ *
+ * @private
+ */
+void replay_capture(replay_t* replay, event_record_t* record){
+    board_t* game_board;
+    unsigned int i, index;
+
+    game_board = replay->game_board;
+    index = compute_index_from_params(game_board, record->to % game_board->width, record->to / game_board->width);
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        if ( game_board->flags[i].index == index && game_board->flags[i].owner == 0 ){
+            game_board->flags[i].owner = record->player_pseudo_name;
+            replay->scores[record->player_pseudo_name - 65] += game_board->flags[i].score;
+            replay->captures++;
+            return;
+        }
+    }
+    /* No flag left to capture there. */
+    replay->out_of_order++;
+}
+
+/**
+ * Prints the outcome of a round, then removes its flags from the board.
+ *
+ * @param replay The reference to the replay.
+ * @param record The reference to the EVENT_ROUND_END event.
+ *
+ * @private
+ */
+void end_replayed_round(replay_t* replay, event_record_t* record){
+    unsigned int i, captured;
+    board_t* game_board;
+    cell_t* cell;
+
+    game_board = replay->game_board;
+    captured = 0;
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        captured += game_board->flags[i].owner != 0 ? 1 : 0;
+    }
+    replay->rounds++;
+    replay->moves += record->from;
+    if ( replay->draw == 1 ){
+        render_board(replay->renderer, game_board);
+    }
+    printf("Round %u: %u of %u flags captured, %u moves in %.3f seconds.\n", record->slot, captured, game_board->flag_count, record->from, (double)record->value / 1000000.0);
+    print_replay_scores(replay, "Scores");
+    for ( i = 0 ; i < game_board->flag_count ; i++ ){
+        cell = get_cell(game_board, game_board->flags[i].index);
+        /* Flags left are removed, pawns standing on conquered flags stay. */
+        *cell = CELL_OCCUPANT_TYPE(*cell) == 1 ? 0 : *cell & CELL_OCCUPANT_MASK;
+    }
+    game_board->flag_count = 0;
+}
+
+/**
+ * Rebuilds the board from the events of the given log files and prints the outcome of each round.
+ *
+ * @param paths The paths to the log files, a merged log or the files written by the processes of a single game.
+ * @param file_count The amount of log files.
+ * @param draw If set to "1" the board is drawn at the end of each round.
+ *
+ * @private
+ */
+void replay_logs(char** paths, unsigned int file_count, boolean draw){
+    unsigned long i, length, dropped;
+    loaded_event_t* events;
+    event_record_t* record;
+    board_t* game_board;
+    replay_t replay;
+    cell_t* cell;
+
+    events = load_events(paths, file_count, &length, &dropped);
+    memset(&replay, 0, sizeof(replay_t));
+    replay.draw = draw;
+    for ( i = 0 ; i < length ; i++ ){
+        record = &events[i].record;
+        if ( record->type != EVENT_GAME_START && replay.game_board == NULL ){
+            /* The log doesn't start with a game, as when the master process' file is missing. */
+            printf("The first event is not the start of a game, aborting.\n");
+            exit(1);
+        }
+        game_board = replay.game_board;
+        switch ( record->type ){
+            case EVENT_GAME_START: {
+                start_replayed_game(&replay, record);
+            }break;
+            case EVENT_PLACEMENT:
+            case EVENT_MOVE: {
+                replay_pawn_move(&replay, record);
+            }break;
+            case EVENT_CAPTURE: {
+                replay_capture(&replay, record);
+            }break;
+            case EVENT_FLAG: {
+                if ( game_board->flag_count < MAX_FLAGS ){
+                    cell = get_replayed_cell(&replay, record->to);
+                    *cell = MAKE_CELL(1, 0, record->value);
+                    game_board->flags[game_board->flag_count].index = compute_index_from_params(game_board, record->to % game_board->width, record->to / game_board->width);
+                    game_board->flags[game_board->flag_count].score = record->value;
+                    game_board->flags[game_board->flag_count].owner = 0;
+                    game_board->flag_count++;
+                }
+            }break;
+            case EVENT_ROUND_END: {
+                end_replayed_round(&replay, record);
+            }break;
+        }
+    }
+    printf("Replay: \n");
+    printf("\tEvents: %lu from %u files.\n", length, file_count);
+    printf("\tGames: %u, rounds: %u, moves: %lu, flags captured: %u.\n", replay.games, replay.rounds, replay.moves, replay.captures);
+    if ( replay.games > 0 ){
+        print_replay_scores(&replay, "Final scores");
+    }
+    printf("\tEvents applied out of order: %u.\n", replay.out_of_order);
+    if ( dropped > 0 ){
+        printf("\tEvents that didn't fit in the logs: %lu.\n", dropped);
+    }
+    if ( replay.game_board != NULL ){
+        destroy_renderer(replay.renderer);
+        destroy_board(replay.game_board);
+    }
+    free(replay.occupants);
+    free(replay.positions);
+    free(events);
+}
+
+int main(int argc, char** argv){
+    if ( argc > 3 && strcmp(argv[1], "merge") == 0 ){
+        merge_logs(argv[2], argv + 3, (unsigned int)( argc - 3 ));
+    }else if ( argc > 2 && strcmp(argv[1], "dump") == 0 ){
+        dump_logs(argv + 2, (unsigned int)( argc - 2 ));
+    }else if ( argc > 2 && ( strcmp(argv[1], "replay") == 0 || strcmp(argv[1], "draw") == 0 ) ){
+        replay_logs(argv + 2, (unsigned int)( argc - 2 ), strcmp(argv[1], "draw") == 0 ? 1 : 0);
+    }else{
+        printf("Usage: %s merge <output> <event log>...\n", argv[0]);
+        printf("       %s dump <event log>...\n", argv[0]);
+        printf("       %s replay <event log>...\n", argv[0]);
+        printf("       %s draw <event log>...\n", argv[0]);
+        printf("Event logs are written by prochess when built with SO_EVENT_LOG, and by prochess-simulator.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,308 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "../lib/board.h"
+#include "../lib/pawn.h"
+#include "../lib/player.h"
+#include "../lib/random.h"
+#include "../lib/recorder.h"
+#include "../lib/types.h"
+
+/**
+ * The maximum amount of rounds a simulated game can last, a game ends only when a round runs out of time so one where pawns
+ * keep getting to every flag would never end.
+ */
+#define MAX_SIMULATED_ROUNDS 200
+
+/**
+ * Contains the game parameters the simulation is run with, they mirror the presets defined in "prochess.c" along with the order the cells are stored in.
+ */
+typedef struct {
+    const char* name;
+    unsigned int player_count;
+    unsigned int pawn_count;
+    unsigned int max_time;
+    unsigned int width;
+    unsigned int height;
+    unsigned int flag_min;
+    unsigned int flag_max;
+    unsigned int round_score;
+    unsigned int max_moves;
+    long waiting_time;
+    unsigned short layout;
+} simulation_config_t;
+
+/**
+ * Contains the outcome of a simulated game.
+ */
+typedef struct {
+    unsigned int rounds;
+    unsigned long moves;
+    unsigned int captures;
+    unsigned long virtual_time;
+    boolean round_limit_reached;
+} simulation_result_t;
+
+/**
+ * The presets a simulation can be run with: SO_NUM_G, SO_NUM_P, SO_MAX_TIME, SO_BASE, SO_ALTEZZA, SO_FLAG_MIN, SO_FLAG_MAX, SO_ROUND_SCORE, SO_N_MOVES,
+ * SO_MIN_HOLD_NSEC and SO_BOARD_LAYOUT. The "huge" one has no counterpart in "prochess.c", it plays on a 10000x10000 sparse board.
+ */
+simulation_config_t presets[] = {
+    { "dev", 2, 10, 3, 24, 18, 5, 5, 10, 1, 10000000, BOARD_LAYOUT_COLUMNS },
+    { "easy", 2, 10, 3, 60, 20, 5, 5, 10, 20, 100000000, BOARD_LAYOUT_COLUMNS },
+    { "hard", 4, 400, 1, 120, 40, 5, 40, 200, 200, 100000000, BOARD_LAYOUT_COLUMNS },
+    { "huge", 4, 2000, 3, 10000, 10000, 5, 40, 200, 200, 10000000, BOARD_LAYOUT_SPARSE }
+};
+
+/**
+ * Returns the current value of the monotonic clock in seconds, it is only used to measure the simulator itself.
+ *
+ * @return A floating point number representing the current time.
+ *
+ * @private
+ */
+double get_wall_time(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Returns the preset having the given name.
+ *
+ * @param name The name of the preset.
+ *
+ * @return The reference to the preset found or NULL if no preset has the given name.
+ *
+ * @private
+ */
+simulation_config_t* get_preset(const char* name){
+    unsigned int i;
+
+    for ( i = 0 ; i < sizeof(presets) / sizeof(simulation_config_t) ; i++ ){
+        if ( strcmp(presets[i].name, name) == 0 ){
+            return &presets[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Mixes a value into a running FNV-1a digest, the digest of a whole run is used to check that results are reproducible.
+ *
+ * @param digest The current digest.
+ * @param value The value to mix in.
+ *
+ * @return The new digest.
+ *
+ * @private
+ */
+unsigned int update_digest(unsigned int digest, unsigned long value){
+    unsigned int i;
+
+    for ( i = 0 ; i < sizeof(unsigned long) ; i++ ){
+        digest = ( digest ^ (unsigned int)( ( value >> ( i * 8 ) ) & 0xff ) ) * 16777619U;
+    }
+    return digest;
+}
+
+/**
+ * Plays a whole game on the given board: pawns move one at a time on a virtual clock that advances by the hold time at each tick,
+ * a round ends when all the flags are captured and the game ends when a round lasts longer than the time limit or after MAX_SIMULATED_ROUNDS rounds.
+ *
+ * @param config The reference to the game parameters.
+ * @param game_board The reference to the game board, it is cleared before the game starts.
+ * @param pawn_list The reference to the list the pawns will be stored in.
+ * @param player_list The reference to the list of the players.
+ * @param seed The seed of the game.
+ *
+ * @return The outcome of the game.
+ *
+ * @private
+ */
+simulation_result_t simulate_game(simulation_config_t* config, board_t* game_board, pawn_context_t* pawn_list, player_t* player_list, unsigned long seed){
+    unsigned int i, k, pawn_total, playing, tick, flag_count, capture_generation, round_moves;
+    unsigned long round_time, max_round_time;
+    simulation_result_t result;
+    coords_t position;
+
+    pawn_total = config->player_count * config->pawn_count;
+    max_round_time = (unsigned long)config->max_time * 1000000000UL;
+    memset(&result, 0, sizeof(simulation_result_t));
+    seed_board(game_board, seed);
+    clear_board(game_board);
+    record_event(EVENT_GAME_START, 0, pawn_total, config->width, config->height, (unsigned int)seed);
+    for ( i = 0 ; i < config->player_count ; i++ ){
+        player_list[i].pseudo_name = i + 65;
+        player_list[i].total_moves = player_list[i].available_moves = config->pawn_count * config->max_moves;
+        player_list[i].total_score = player_list[i].global_score = 0;
+    }
+    /* Pawns are placed in turns, slot "i" belongs to player "i % player_count". */
+    plan_pawn_placement(game_board, pawn_total);
+    for ( i = 0 ; i < pawn_total ; i++ ){
+        if ( get_planned_position(game_board, i, &position) == 1 ){
+            init_simulated_pawn(&pawn_list[i], game_board, player_list[i % config->player_count].pseudo_name, config->max_moves, &position, i);
+        }else{
+            init_simulated_pawn(&pawn_list[i], game_board, player_list[i % config->player_count].pseudo_name, config->max_moves, NULL, i);
+        }
+    }
+    tick = 0;
+    while (1){
+        flag_count = spawn_flags(game_board, config->flag_min, config->flag_max, config->round_score);
+        result.rounds++;
+        record_flags(game_board);
+        game_board->round_in_progress = 1;
+        record_event(EVENT_ROUND_START, 0, result.rounds, 0, 0, flag_count);
+        /* What each player does once it is warned a new round is about to start. */
+        for ( i = 0 ; i < config->player_count ; i++ ){
+            plan_pawn_targets(game_board, i, config->player_count, config->pawn_count, config->max_moves);
+        }
+        for ( i = 0 ; i < pawn_total ; i++ ){
+            start_simulated_round(&pawn_list[i]);
+        }
+        round_time = 0;
+        playing = pawn_total;
+        while ( playing > 0 && round_time < max_round_time && all_flags_captured(game_board) == 0 ){
+            playing = 0;
+            /* Every pawn moves once per tick, the first pawn to move rotates so that no player always moves first. */
+            for ( k = 0 ; k < pawn_total ; k++ ){
+                capture_generation = game_board->capture_generation;
+                playing += step_simulated_pawn(&pawn_list[( k + tick ) % pawn_total]);
+                if ( game_board->capture_generation != capture_generation ){
+                    /* What the master process does when a capture is signalled. */
+                    update_distance_map(game_board);
+                }
+            }
+            round_time += game_board->waiting_time;
+            tick++;
+        }
+        game_board->round_in_progress = 0;
+        update_players_score(game_board, player_list, config->player_count, 1);
+        round_moves = update_players_moves(game_board, player_list, config->player_count);
+        result.moves += round_moves;
+        /* The virtual clock gives the duration, so that replaying the log of a simulation gives the same figures. */
+        record_event(EVENT_ROUND_END, 0, result.rounds, round_moves, 0, (unsigned int)( ( all_flags_captured(game_board) == 0 ? max_round_time : round_time ) / 1000UL ));
+        if ( all_flags_captured(game_board) == 0 ){
+            /* Nobody can capture the remaining flags, the virtual clock runs until the time limit. */
+            for ( i = 0 ; i < flag_count ; i++ ){
+                result.captures += game_board->flags[i].owner != 0 ? 1 : 0;
+            }
+            result.virtual_time += max_round_time;
+            break;
+        }
+        result.captures += flag_count;
+        result.virtual_time += round_time;
+        if ( result.rounds == MAX_SIMULATED_ROUNDS ){
+            result.round_limit_reached = 1;
+            break;
+        }
+        remove_flags(game_board);
+        reset_players_moves(game_board, player_list, config->player_count);
+    }
+    return result;
+}
+
+/**
+ * Runs the given amount of games and prints out the aggregated metrics.
+ *
+ * @param config The reference to the game parameters.
+ * @param games The amount of games to play.
+ * @param seed The seed the seeds of the games are drawn from, the same seed always gives the same results.
+ *
+ * @private
+ */
+void run_simulation(simulation_config_t* config, unsigned int games, unsigned long seed){
+    player_t player_list[MAX_PLAYERS], totals[MAX_PLAYERS];
+    unsigned long moves, virtual_time;
+    unsigned int i, j, rounds, captures, digest, unfinished_games;
+    simulation_result_t result;
+    pawn_context_t* pawn_list;
+    struct rusage usage;
+    random_t generator;
+    double start, elapsed;
+    board_t* game_board;
+
+    if ( config->player_count > MAX_PLAYERS ){
+        printf("Too many players, at most %d are supported.\n", MAX_PLAYERS);
+        exit(1);
+    }
+    game_board = generate_local_board(config->width, config->height, EXECUTION_MODE_SIMULATION, config->layout);
+    game_board->waiting_time = config->waiting_time;
+    pawn_list = (pawn_context_t*)malloc(sizeof(pawn_context_t) * config->player_count * config->pawn_count);
+    if ( pawn_list == NULL ){
+        printf("Cannot allocate the pawns, aborting.\n");
+        exit(1);
+    }
+    memset(totals, 0, sizeof(totals));
+    moves = virtual_time = 0;
+    rounds = captures = unfinished_games = 0;
+    digest = 2166136261U;
+    seed_random(&generator, seed, 0);
+    printf("Simulating %u %s games with seed %lu...\n", games, config->name, seed);
+    start = get_wall_time();
+    for ( i = 0 ; i < games ; i++ ){
+        result = simulate_game(config, game_board, pawn_list, player_list, next_random(&generator));
+        rounds += result.rounds;
+        moves += result.moves;
+        captures += result.captures;
+        unfinished_games += result.round_limit_reached;
+        virtual_time += result.virtual_time;
+        digest = update_digest(digest, result.rounds);
+        digest = update_digest(digest, result.moves);
+        for ( j = 0 ; j < config->player_count ; j++ ){
+            totals[j].pseudo_name = player_list[j].pseudo_name;
+            totals[j].available_moves += player_list[j].available_moves;
+            totals[j].total_moves += player_list[j].total_moves;
+            totals[j].global_score += player_list[j].global_score;
+            digest = update_digest(digest, player_list[j].global_score);
+            digest = update_digest(digest, player_list[j].available_moves);
+        }
+    }
+    elapsed = get_wall_time() - start;
+    /* Moves and scores are summed over all the games, so ratios are averages. */
+    print_metrics(totals, config->player_count, rounds, (unsigned int)( virtual_time / 1000000000UL ));
+    printf("Simulation: \n");
+    printf("\tGames: %u, rounds: %u, flags captured: %u.\n", games, rounds, captures);
+    if ( unfinished_games > 0 ){
+        printf("\tGames stopped after %d rounds: %u.\n", MAX_SIMULATED_ROUNDS, unfinished_games);
+    }
+    if ( captures > 0 ){
+        printf("\tMoves per capture: %.1f.\n", (double)moves / (double)captures);
+    }
+    printf("\tVirtual time: %.1f seconds.\n", (double)virtual_time / 1000000000.0);
+    printf("\tWall time: %.3f seconds.\n", elapsed);
+    if ( elapsed > 0 ){
+        printf("\tMoves/sec: %.0f.\n", (double)moves / elapsed);
+    }
+    /* The board is allocated lazily, so this tells how much of it has actually been touched. */
+    getrusage(RUSAGE_SELF, &usage);
+    printf("\tPeak memory: %ld KB.\n", usage.ru_maxrss);
+    printf("\tDigest: %08x.\n", digest);
+    free(pawn_list);
+}
+
+int main(int argc, char** argv){
+    simulation_config_t* config;
+    unsigned int games;
+    unsigned long seed;
+
+    config = get_preset(argc > 1 ? argv[1] : "hard");
+    if ( config == NULL ){
+        printf("Usage: %s [dev|easy|hard|huge] [games] [seed] [event log directory]\n", argv[0]);
+        return 1;
+    }
+    games = argc > 2 ? (unsigned int)atoi(argv[2]) : 100;
+    seed = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    if ( argc > 4 ){
+        /* Every game is recorded in the same file, each one starts with its own EVENT_GAME_START event. */
+        start_event_log(argv[4]);
+    }
+    run_simulation(config, games, seed);
+    return 0;
+}
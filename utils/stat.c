@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/board.h"
+#include "../lib/communicator.h"
+#include "../lib/telemetry.h"
+#include "../lib/types.h"
+
+/**
+ * The amount of rows printed before the column names are printed again.
+ */
+#define STAT_HEADER_INTERVAL 20
+
+/**
+ * Set once the tool is asked to stop.
+ */
+volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * Handles the "SIGINT" and "SIGTERM" signals.
+ *
+ * @param signo The signal to handle.
+ *
+ * @private
+ */
+void signal_handler(int signo){
+    stop_requested = 1;
+}
+
+/**
+ * Prints the given percentile of a histogram scaled to the given unit, or a dash if nothing has been counted.
+ *
+ * @param histogram The reference to the histogram.
+ * @param percentile The percentage, between 0 and 100.
+ * @param unit The amount of nanoseconds in the unit the value is printed in.
+ *
+ * @private
+ */
+void print_percentile(histogram_t* histogram, double percentile, double unit){
+    if ( get_histogram_count(histogram) == 0 ){
+        printf(" %8s", "-");
+    }else{
+        printf(" %8.1f", (double)get_histogram_percentile(histogram, percentile) / unit);
+    }
+}
+
+/**
+ * Adds up the moves counted by the pawns in their slots.
+ *
+ * @param game_board The reference to the game board.
+ * @param moves The reference to the variable where the amount of moves done will be stored at.
+ * @param blocked_moves The reference to the variable where the amount of moves blocked by another pawn will be stored at.
+ *
+ * @private
+ */
+void count_moves(board_t* game_board, unsigned long* moves, unsigned long* blocked_moves){
+    unsigned int i, count;
+    pawn_slot_t* slots;
+
+    slots = get_pawn_slots(game_board);
+    count = __atomic_load_n(&game_board->pawn_slot_count, __ATOMIC_ACQUIRE);
+    *moves = *blocked_moves = 0;
+    for ( i = 0 ; i < count ; i++ ){
+        *moves += __atomic_load_n(&slots[i].moves, __ATOMIC_RELAXED);
+        *blocked_moves += __atomic_load_n(&slots[i].blocked_moves, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Prints the amount of messages waiting for the coordinator and for the pawns, the latter only when pawns run as processes.
+ *
+ * @param game_board The reference to the game board.
+ *
+ * @private
+ */
+void print_queue_depths(board_t* game_board){
+    unsigned int i, count;
+    int depth, total, max;
+    pawn_slot_t* slots;
+
+    if ( game_board->transport == TRANSPORT_MESSAGE_RING ){
+        depth = (int)get_message_ring_depth(&game_board->coordinator_ring);
+    }else{
+        depth = get_message_queue_depth(game_board->coordinator_mq_id);
+    }
+    printf(" %6d", depth);
+    slots = get_pawn_slots(game_board);
+    count = __atomic_load_n(&game_board->pawn_slot_count, __ATOMIC_ACQUIRE);
+    total = max = 0;
+    for ( i = 0 ; i < count ; i++ ){
+        depth = get_message_queue_depth(__atomic_load_n(&slots[i].mq_id, __ATOMIC_RELAXED));
+        if ( depth > 0 ){
+            total += depth;
+            max = depth > max ? depth : max;
+        }
+    }
+    printf(" %6d %6d", total, max);
+}
+
+/**
+ * Prints the figures of the whole game gathered so far.
+ *
+ * @param game_board The reference to the game board.
+ * @param telemetry The reference to the telemetry of the game.
+ *
+ * @private
+ */
+void print_game_summary(board_t* game_board, telemetry_t* telemetry){
+    unsigned long moves, blocked_moves;
+    histogram_t* histograms[4];
+    const char* names[4];
+    double units[4];
+    unsigned int i;
+
+    histograms[0] = &telemetry->move_latency;
+    histograms[1] = &telemetry->claim_time;
+    histograms[2] = &telemetry->message_round_trip;
+    histograms[3] = &telemetry->capture_time;
+    names[0] = "Move latency (us)";
+    names[1] = "Cell claim (us)";
+    names[2] = "Round trip (us)";
+    names[3] = "Capture time (ms)";
+    units[0] = units[1] = units[2] = 1000.0;
+    units[3] = 1000000.0;
+    printf("Game: \n");
+    count_moves(game_board, &moves, &blocked_moves);
+    printf("\tRounds: %u, moves: %lu, blocked moves: %lu.\n", telemetry->rounds, moves, blocked_moves);
+    if ( telemetry->moves_measured == 1 ){
+        printf("\tClaim retries: %lu.\n", telemetry->claim_retries);
+    }else{
+        printf("\tMove latency, claim time and retries are only measured when built with SO_TELEMETRY.\n");
+    }
+    printf("\t%-18s %8s %8s %8s %8s %8s %8s\n", "", "count", "p50", "p90", "p99", "p99.9", "max");
+    for ( i = 0 ; i < 4 ; i++ ){
+        printf("\t%-18s %8lu", names[i], get_histogram_count(histograms[i]));
+        print_percentile(histograms[i], 50, units[i]);
+        print_percentile(histograms[i], 90, units[i]);
+        print_percentile(histograms[i], 99, units[i]);
+        print_percentile(histograms[i], 99.9, units[i]);
+        print_percentile(histograms[i], 100, units[i]);
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv){
+    unsigned long moves, blocked_moves, previous_moves, previous_blocked_moves;
+    telemetry_t *current, *previous;
+    unsigned int rows, count;
+    histogram_t interval;
+    struct timespec pause;
+    board_t* game_board;
+    double delay;
+
+    if ( argc < 2 ){
+        printf("Usage: %s <board segment> [interval in seconds] [count]\n", argv[0]);
+        printf("The board segment is printed by prochess at startup.\n");
+        return 1;
+    }
+    delay = argc > 2 ? atof(argv[2]) : 1;
+    delay = delay > 0 ? delay : 1;
+    count = argc > 3 ? (unsigned int)atoi(argv[3]) : 0;
+    game_board = attach_board(argv[1]);
+    /* Each row tells what happened since the previous one, so a copy of the figures is kept. */
+    current = (telemetry_t*)malloc(sizeof(telemetry_t));
+    previous = (telemetry_t*)malloc(sizeof(telemetry_t));
+    if ( current == NULL || previous == NULL ){
+        printf("Cannot allocate the telemetry, aborting.\n");
+        return 1;
+    }
+    memcpy(previous, &game_board->telemetry, sizeof(telemetry_t));
+    count_moves(game_board, &previous_moves, &previous_blocked_moves);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    pause.tv_sec = (time_t)delay;
+    pause.tv_nsec = (long)( ( delay - (double)pause.tv_sec ) * 1000000000.0 );
+    rows = 0;
+    /* Keep printing until the master process is gone. */
+    while ( stop_requested == 0 && ( count == 0 || rows < count ) && ( kill(game_board->coordinator_pid, 0) == 0 || errno == EPERM ) ){
+        nanosleep(&pause, NULL);
+        if ( rows % STAT_HEADER_INTERVAL == 0 ){
+            printf("%5s %9s %7s %7s %6s %6s %6s %8s %8s %8s %8s %8s %8s\n", "round", "moves/s", "blocked", "retries", "coord", "pawns", "max",
+                "move50", "move99", "claim50", "claim99", "rtt99", "capt50ms");
+        }
+        /* Figures are only ever added to, a copy taken while pawns play is at most a few values behind. */
+        memcpy(current, &game_board->telemetry, sizeof(telemetry_t));
+        count_moves(game_board, &moves, &blocked_moves);
+        printf("%5u %9.0f %7lu", current->rounds, (double)( moves - previous_moves ) / delay, blocked_moves - previous_blocked_moves);
+        if ( current->moves_measured == 1 ){
+            printf(" %7lu", current->claim_retries - previous->claim_retries);
+        }else{
+            printf(" %7s", "-");
+        }
+        print_queue_depths(game_board);
+        subtract_histogram(&interval, &current->move_latency, &previous->move_latency);
+        print_percentile(&interval, 50, 1000.0);
+        print_percentile(&interval, 99, 1000.0);
+        subtract_histogram(&interval, &current->claim_time, &previous->claim_time);
+        print_percentile(&interval, 50, 1000.0);
+        print_percentile(&interval, 99, 1000.0);
+        subtract_histogram(&interval, &current->message_round_trip, &previous->message_round_trip);
+        print_percentile(&interval, 99, 1000.0);
+        subtract_histogram(&interval, &current->capture_time, &previous->capture_time);
+        print_percentile(&interval, 50, 1000000.0);
+        printf("\n");
+        fflush(stdout);
+        memcpy(previous, current, sizeof(telemetry_t));
+        previous_moves = moves;
+        previous_blocked_moves = blocked_moves;
+        rows++;
+    }
+    memcpy(current, &game_board->telemetry, sizeof(telemetry_t));
+    print_game_summary(game_board, current);
+    free(previous);
+    free(current);
+    return 0;
+}
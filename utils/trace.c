@@ -0,0 +1,175 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/tracer.h"
+#include "../lib/types.h"
+
+/**
+ * Contains the figures of a type of span over all the trace buffers.
+ */
+typedef struct {
+    unsigned long count;
+    unsigned long total;
+    unsigned int max;
+} span_summary_t;
+
+/**
+ * Writes the name of the given track.
+ *
+ * @param track The track (TRACE_TRACK_*).
+ * @param name The buffer the name will be written to.
+ *
+ * @private
+ */
+void get_track_name(unsigned int track, char* name){
+    if ( track == TRACE_TRACK_MASTER ){
+        strcpy(name, "master");
+    }else if ( track < TRACE_TRACK_PAWN(0) ){
+        sprintf(name, "player %c", (char)( track - TRACE_TRACK_PLAYER(0) + 65 ));
+    }else{
+        sprintf(name, "pawn %u", track - TRACE_TRACK_PAWN(0));
+    }
+}
+
+/**
+ * Reads the spans of a trace buffer file, spans that have been reserved but never written are left out.
+ *
+ * @param path The path to the file.
+ * @param header The reference to the header, it is read from the file.
+ * @param length The reference to the variable where the amount of spans read will be stored at.
+ *
+ * @return The reference to the spans read, it must be freed once done.
+ *
+ * @private
+ */
+trace_record_t* load_trace_buffer(const char* path, trace_header_t* header, unsigned long* length){
+    trace_record_t* records;
+    unsigned long i, count;
+    FILE* stream;
+
+    stream = fopen(path, "rb");
+    if ( stream == NULL || fread(header, sizeof(trace_header_t), 1, stream) != 1 || memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ){
+        printf("Cannot read the trace buffer %s, aborting.\n", path);
+        exit(1);
+    }
+    if ( header->version != TRACE_VERSION || header->record_size != sizeof(trace_record_t) || header->capacity == 0 ){
+        printf("The trace buffer %s has been written by another version, aborting.\n", path);
+        exit(1);
+    }
+    /* Once the ring has wrapped around every slot holds a span. */
+    count = header->head < header->capacity ? header->head : header->capacity;
+    records = (trace_record_t*)malloc(sizeof(trace_record_t) * ( count + 1 ));
+    if ( records == NULL || fread(records, sizeof(trace_record_t), count, stream) != count ){
+        printf("Cannot read the trace buffer %s, aborting.\n", path);
+        exit(1);
+    }
+    fclose(stream);
+    *length = 0;
+    for ( i = 0 ; i < count ; i++ ){
+        if ( records[i].start != 0 && records[i].span < TRACE_SPAN_COUNT ){
+            records[(*length)++] = records[i];
+        }
+    }
+    return records;
+}
+
+/**
+ * Writes the spans of the given trace buffers as a Chrome trace, which Perfetto and "chrome://tracing" open: each process is drawn
+ * on its own, each player and pawn on its own track. A summary of each type of span is printed as well.
+ *
+ * @param output The path to the JSON file to write.
+ * @param paths The paths to the trace buffer files.
+ * @param file_count The amount of trace buffer files.
+ *
+ * @private
+ */
+void export_trace(const char* output, char** paths, unsigned int file_count){
+    span_summary_t summaries[TRACE_SPAN_COUNT];
+    unsigned long i, origin, spans, *lengths;
+    unsigned int file, track, max_track;
+    trace_header_t* headers;
+    trace_record_t** records;
+    const char* separator;
+    unsigned char* named;
+    char name[64];
+    FILE* stream;
+
+    headers = (trace_header_t*)malloc(sizeof(trace_header_t) * file_count);
+    records = (trace_record_t**)malloc(sizeof(trace_record_t*) * file_count);
+    lengths = (unsigned long*)malloc(sizeof(unsigned long) * file_count);
+    if ( headers == NULL || records == NULL || lengths == NULL ){
+        printf("Cannot allocate the trace, aborting.\n");
+        exit(1);
+    }
+    /* Timestamps are written relative to the first span, so that they stay readable. */
+    origin = (unsigned long)-1;
+    max_track = 0;
+    spans = 0;
+    for ( file = 0 ; file < file_count ; file++ ){
+        records[file] = load_trace_buffer(paths[file], &headers[file], &lengths[file]);
+        spans += lengths[file];
+        for ( i = 0 ; i < lengths[file] ; i++ ){
+            origin = records[file][i].start < origin ? records[file][i].start : origin;
+            max_track = records[file][i].track > max_track ? records[file][i].track : max_track;
+        }
+    }
+    named = (unsigned char*)malloc(max_track + 1);
+    stream = fopen(output, "w");
+    if ( named == NULL || stream == NULL ){
+        printf("Cannot write the trace %s, aborting.\n", output);
+        exit(1);
+    }
+    memset(summaries, 0, sizeof(summaries));
+    fprintf(stream, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    /* Events are separated rather than terminated, as a trailing comma is not valid JSON. */
+    separator = "\n";
+    for ( file = 0 ; file < file_count ; file++ ){
+        fprintf(stream, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"prochess %d\"}}", separator, headers[file].pid, headers[file].pid);
+        separator = ",\n";
+        memset(named, 0, max_track + 1);
+        for ( i = 0 ; i < lengths[file] ; i++ ){
+            track = records[file][i].track;
+            if ( named[track] == 0 ){
+                /* Tracks are named the first time they are met in each process. */
+                named[track] = 1;
+                get_track_name(track, name);
+                fprintf(stream, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", headers[file].pid, track, name);
+            }
+            fprintf(stream, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", get_trace_span_name(records[file][i].span), headers[file].pid,
+                track, (double)( records[file][i].start - origin ) / 1000.0, (double)records[file][i].duration / 1000.0);
+            summaries[records[file][i].span].count++;
+            summaries[records[file][i].span].total += records[file][i].duration;
+            if ( records[file][i].duration > summaries[records[file][i].span].max ){
+                summaries[records[file][i].span].max = records[file][i].duration;
+            }
+        }
+        free(records[file]);
+    }
+    fprintf(stream, "\n]}\n");
+    fclose(stream);
+    printf("Exported %lu spans from %u trace buffers into %s.\n", spans, file_count, output);
+    printf("Spans: \n");
+    for ( i = 0 ; i < TRACE_SPAN_COUNT ; i++ ){
+        if ( summaries[i].count > 0 ){
+            printf("\t%-10s count: %lu, total: %.3f s, average: %.1f us, max: %.1f us.\n", get_trace_span_name((unsigned int)i), summaries[i].count, (double)summaries[i].total / 1000000000.0,
+                (double)summaries[i].total / (double)summaries[i].count / 1000.0, (double)summaries[i].max / 1000.0);
+        }
+    }
+    free(named);
+    free(lengths);
+    free(records);
+    free(headers);
+}
+
+int main(int argc, char** argv){
+    if ( argc < 3 ){
+        printf("Usage: %s <output.json> <trace buffer>...\n", argv[0]);
+        printf("Trace buffers are written by prochess when every object is built with SO_TRACE defined as a directory.\n");
+        return 1;
+    }
+    export_trace(argv[1], argv + 2, (unsigned int)( argc - 2 ));
+    return 0;
+}
@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lib/board.h"
+#include "../lib/player.h"
+#include "../lib/renderer.h"
+#include "../lib/types.h"
+
+/**
+ * The amount of copies taken at most for each frame, a frame is skipped if the board keeps changing while it is copied.
+ */
+#define MAX_SNAPSHOT_ATTEMPTS 1000
+
+/**
+ * Set once the viewer is asked to stop.
+ */
+volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * Handles the "SIGINT" and "SIGTERM" signals.
+ *
+ * @param signo The signal to handle.
+ *
+ * @private
+ */
+void signal_handler(int signo){
+    stop_requested = 1;
+}
+
+/**
+ * Returns the current value of the monotonic clock in seconds.
+ *
+ * @return A floating point number representing the current time.
+ *
+ * @private
+ */
+double get_current_time(){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Prints a line telling the round state and the score each player has made in current round, only if it has changed since the last one.
+ *
+ * @param snapshot The reference to the copy of the game board.
+ * @param last_status The last line printed, it is replaced with the new one.
+ *
+ * @private
+ */
+void print_round_status(board_t* snapshot, char* last_status){
+    unsigned int i, captured, score;
+    char status[512];
+    size_t length;
+
+    captured = 0;
+    for ( i = 0 ; i < snapshot->flag_count ; i++ ){
+        captured += snapshot->flags[i].owner != 0 ? 1 : 0;
+    }
+    length = (size_t)sprintf(status, "%s, %u of %u flags captured.", snapshot->round_in_progress == 1 ? "Playing" : "Waiting", captured, snapshot->flag_count);
+    for ( i = 0 ; i < MAX_PLAYERS ; i++ ){
+        score = get_player_score(snapshot, (char)( i + 65 ));
+        if ( score > 0 ){
+            length += (size_t)sprintf(status + length, " %c: %u.", (char)( i + 65 ), score);
+        }
+    }
+    if ( strcmp(status, last_status) != 0 ){
+        printf("%s\n", status);
+        strcpy(last_status, status);
+    }
+}
+
+int main(int argc, char** argv){
+    unsigned int frames, skipped_frames, attempts, retries;
+    char last_status[512];
+    struct timespec pause;
+    renderer_t* renderer;
+    board_t *game_board, *snapshot;
+    double frame_rate, next_frame, remaining;
+
+    if ( argc < 2 ){
+        printf("Usage: %s <board segment> [frames per second]\n", argv[0]);
+        printf("The board segment is printed by prochess at startup.\n");
+        return 1;
+    }
+    frame_rate = argc > 2 ? atof(argv[2]) : 10;
+    frame_rate = frame_rate > 0 ? frame_rate : 10;
+    game_board = attach_board(argv[1]);
+    /* Frames are drawn from a local copy of the board, the one in shared memory is never written. */
+    snapshot = generate_local_board(game_board->width, game_board->height, EXECUTION_MODE_SIMULATION, game_board->layout);
+    renderer = create_renderer(snapshot, STDOUT_FILENO, 1);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    frames = skipped_frames = retries = 0;
+    last_status[0] = '\0';
+    next_frame = get_current_time();
+    /* Keep drawing until the master process is gone. */
+    while ( stop_requested == 0 && ( kill(game_board->coordinator_pid, 0) == 0 || errno == EPERM ) ){
+        attempts = take_board_snapshot(game_board, snapshot, MAX_SNAPSHOT_ATTEMPTS);
+        if ( attempts == 0 ){
+            skipped_frames++;
+        }else{
+            frames++;
+            retries += attempts - 1;
+            render_board(renderer, snapshot);
+            print_round_status(snapshot, last_status);
+        }
+        next_frame += 1.0 / frame_rate;
+        remaining = next_frame - get_current_time();
+        if ( remaining > 0 ){
+            pause.tv_sec = (time_t)remaining;
+            pause.tv_nsec = (long)( ( remaining - (double)pause.tv_sec ) * 1000000000.0 );
+            nanosleep(&pause, NULL);
+        }else{
+            /* Drawing takes longer than a frame, don't try to catch up. */
+            next_frame = get_current_time();
+        }
+    }
+    destroy_renderer(renderer);
+    printf("Frames drawn: %u, skipped: %u, copies taken again: %u.\n", frames, skipped_frames, retries);
+    return 0;
+}